@@ -10,6 +10,11 @@ pub enum SoftKeyboardVisibility {
 	hidden
 }
 
+// Context maps the static fields of `android.content.Context` used here.
+struct Context {
+	input_method_service jni.JavaObject @[java: 'INPUT_METHOD_SERVICE'; java_type: 'Ljava/lang/String;']
+}
+
 // visibility set the visibility of the soft input on Android.
 // it's a pure JNI implementation so no special calls is needed on the Java side.
 // The major caveat is that, currently, there's no *reliable* way to get key events.
@@ -23,21 +28,19 @@ pub fn visibility(soft_visibility SoftKeyboardVisibility) bool {
 			eprintln(@MOD + '.' + @FN + ': ${soft_visibility}')
 		}
 
-		env, need_detach := jni.env_detach()
+		env := jni.default_env()
+		// The thread stays attached, so local references must be released explicitly
+		mut frame := jni.local_frame(env, 32)
 		defer {
-			jni.detach_thread(need_detach)
+			frame.pop(jni.JavaObject(unsafe { nil }))
 		}
 
 		// Retrieve NativeActivity
 		activity := android.activity() or { panic(@MOD + '.' + @FN + ': ' + err.msg()) }
 		activity_class := jni.get_object_class(env, activity.clazz)
 
-		// Retrieve Context.INPUT_METHOD_SERVICE
-		class_context := jni.find_class(env, 'android.content.Context')
-		fld_input_method_service := jni.get_static_field_id(env, class_context, 'INPUT_METHOD_SERVICE',
-			'Ljava/lang/String;')
-
-		input_method_service := jni.get_static_object_field(env, class_context, fld_input_method_service)
+		// Retrieve Context.INPUT_METHOD_SERVICE, the field ID is resolved once and cached
+		input_method_service := jni.static_from_java[Context](env, 'android.content.Context').input_method_service
 		jni.panic_on_exception(env)
 
 		// Runs getSystemService(Context.INPUT_METHOD_SERVICE)
@@ -116,9 +119,11 @@ pub fn is_visible() bool {
 			eprintln(@MOD + '.' + @FN + ' called')
 		}
 
-		env, need_detach := jni.env_detach()
+		env := jni.default_env()
+		// The thread stays attached, so local references must be released explicitly
+		mut frame := jni.local_frame(env, 32)
 		defer {
-			jni.detach_thread(need_detach)
+			frame.pop(jni.JavaObject(unsafe { nil }))
 		}
 
 		// Retrieve NativeActivity
@@ -0,0 +1,257 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+// Typed primitive arrays.
+//
+// The V element type decides which Java array type is used:
+//
+// V type       | Java type
+// -------------------------
+// bool         | boolean[]
+// u8, i8       | byte[]
+// u16          | char[]
+// i16          | short[]
+// int, i32     | int[]
+// i64          | long[]
+// f32          | float[]
+// f64          | double[]
+//
+// Example:
+// ```v
+// samples := []f32{len: 1024 * 1024}
+// arr := jni.array_from_v(env, samples) // One `SetFloatArrayRegion` call
+// back := jni.array_to_v[f32](env, arr) // One `GetFloatArrayRegion` call
+// ```
+
+// ReleaseMode is the `mode` passed when releasing array elements.
+pub enum ReleaseMode {
+	commit_and_free = 0 // copy back the content (if copied) and free the elements
+	commit          = 1 // C.JNI_COMMIT copy back the content but do not free the elements
+	abort           = 2 // C.JNI_ABORT free the elements without copying back changes
+}
+
+// new_array returns a new Java array with `len` elements of the Java type matching `T`.
+pub fn new_array[T](env &Env, len int) JavaArray {
+	$if jni_stats ? {
+		C.gStatsLocalRefs(1)
+	}
+	$if T is bool {
+		return C.NewBooleanArray(env, jsize(len))
+	} $else $if T is u8 || T is i8 {
+		return C.NewByteArray(env, jsize(len))
+	} $else $if T is u16 {
+		return C.NewCharArray(env, jsize(len))
+	} $else $if T is i16 {
+		return C.NewShortArray(env, jsize(len))
+	} $else $if T is int || T is i32 {
+		return C.NewIntArray(env, jsize(len))
+	} $else $if T is i64 {
+		return C.NewLongArray(env, jsize(len))
+	} $else $if T is f32 {
+		return C.NewFloatArray(env, jsize(len))
+	} $else $if T is f64 {
+		return C.NewDoubleArray(env, jsize(len))
+	} $else {
+		$compile_error('jni.new_array: unsupported element type')
+	}
+	return JavaArray(unsafe { nil })
+}
+
+// get_array_region copies `len` elements, starting at `start`, from the Java array `arr` to `buf`.
+@[unsafe]
+pub fn get_array_region[T](env &Env, arr JavaArray, start int, len int, buf &T) {
+	stats_array_bytes(len * int(sizeof(T)))
+	$if T is bool {
+		C.GetBooleanArrayRegion(env, arr, jsize(start), jsize(len), &C.jboolean(buf))
+	} $else $if T is u8 || T is i8 {
+		C.GetByteArrayRegion(env, arr, jsize(start), jsize(len), &C.jbyte(buf))
+	} $else $if T is u16 {
+		C.GetCharArrayRegion(env, arr, jsize(start), jsize(len), &C.jchar(buf))
+	} $else $if T is i16 {
+		C.GetShortArrayRegion(env, arr, jsize(start), jsize(len), &C.jshort(buf))
+	} $else $if T is int || T is i32 {
+		C.GetIntArrayRegion(env, arr, jsize(start), jsize(len), &C.jint(buf))
+	} $else $if T is i64 {
+		C.GetLongArrayRegion(env, arr, jsize(start), jsize(len), &C.jlong(buf))
+	} $else $if T is f32 {
+		C.GetFloatArrayRegion(env, arr, jsize(start), jsize(len), &C.jfloat(buf))
+	} $else $if T is f64 {
+		C.GetDoubleArrayRegion(env, arr, jsize(start), jsize(len), &C.jdouble(buf))
+	} $else {
+		$compile_error('jni.get_array_region: unsupported element type')
+	}
+}
+
+// set_array_region copies `len` elements from `buf` to the Java array `arr`, starting at `start`.
+@[unsafe]
+pub fn set_array_region[T](env &Env, arr JavaArray, start int, len int, buf &T) {
+	stats_array_bytes(len * int(sizeof(T)))
+	$if T is bool {
+		C.SetBooleanArrayRegion(env, arr, jsize(start), jsize(len), &C.jboolean(buf))
+	} $else $if T is u8 || T is i8 {
+		C.SetByteArrayRegion(env, arr, jsize(start), jsize(len), &C.jbyte(buf))
+	} $else $if T is u16 {
+		C.SetCharArrayRegion(env, arr, jsize(start), jsize(len), &C.jchar(buf))
+	} $else $if T is i16 {
+		C.SetShortArrayRegion(env, arr, jsize(start), jsize(len), &C.jshort(buf))
+	} $else $if T is int || T is i32 {
+		C.SetIntArrayRegion(env, arr, jsize(start), jsize(len), &C.jint(buf))
+	} $else $if T is i64 {
+		C.SetLongArrayRegion(env, arr, jsize(start), jsize(len), &C.jlong(buf))
+	} $else $if T is f32 {
+		C.SetFloatArrayRegion(env, arr, jsize(start), jsize(len), &C.jfloat(buf))
+	} $else $if T is f64 {
+		C.SetDoubleArrayRegion(env, arr, jsize(start), jsize(len), &C.jdouble(buf))
+	} $else {
+		$compile_error('jni.set_array_region: unsupported element type')
+	}
+}
+
+// array_to_v returns a copy of the Java array `arr` as a V array.
+pub fn array_to_v[T](env &Env, arr JavaArray) []T {
+	len := get_array_length(env, arr)
+	mut out := []T{len: len}
+	if len > 0 {
+		unsafe { get_array_region[T](env, arr, 0, len, &out[0]) }
+	}
+	return out
+}
+
+// array_from_v returns a new Java array (a local reference) with a copy of `data`.
+pub fn array_from_v[T](env &Env, data []T) JavaArray {
+	arr := new_array[T](env, data.len)
+	if data.len > 0 && !isnil(arr) {
+		unsafe { set_array_region[T](env, arr, 0, data.len, &data[0]) }
+	}
+	return arr
+}
+
+// copy_region copies `dst.len` elements, starting at `start`, from the Java array `arr` to `dst`.
+pub fn copy_region[T](env &Env, arr JavaArray, start int, mut dst []T) {
+	if dst.len > 0 {
+		unsafe { get_array_region[T](env, arr, start, dst.len, &dst[0]) }
+	}
+}
+
+// write_region copies `src` to the Java array `arr`, starting at `start`.
+pub fn write_region[T](env &Env, arr JavaArray, start int, src []T) {
+	if src.len > 0 {
+		unsafe { set_array_region[T](env, arr, start, src.len, &src[0]) }
+	}
+}
+
+// ArrayElements are the elements of a Java array as returned by `Get<Type>ArrayElements`.
+// `data` is a view of the (possibly copied) elements; it must not be used after `release`.
+pub struct ArrayElements[T] {
+pub:
+	arr     JavaArray
+	is_copy bool
+pub mut:
+	data []T
+mut:
+	released bool
+}
+
+// elements returns the elements of the Java array `arr`. The elements must be released with `release`.
+pub fn elements[T](env &Env, arr JavaArray) ArrayElements[T] {
+	len := get_array_length(env, arr)
+	mut is_copy := jboolean(false)
+	mut ptr := unsafe { nil }
+	$if T is bool {
+		ptr = C.GetBooleanArrayElements(env, arr, &is_copy)
+	} $else $if T is u8 || T is i8 {
+		ptr = C.GetByteArrayElements(env, arr, &is_copy)
+	} $else $if T is u16 {
+		ptr = C.GetCharArrayElements(env, arr, &is_copy)
+	} $else $if T is i16 {
+		ptr = C.GetShortArrayElements(env, arr, &is_copy)
+	} $else $if T is int || T is i32 {
+		ptr = C.GetIntArrayElements(env, arr, &is_copy)
+	} $else $if T is i64 {
+		ptr = C.GetLongArrayElements(env, arr, &is_copy)
+	} $else $if T is f32 {
+		ptr = C.GetFloatArrayElements(env, arr, &is_copy)
+	} $else $if T is f64 {
+		ptr = C.GetDoubleArrayElements(env, arr, &is_copy)
+	} $else {
+		$compile_error('jni.elements: unsupported element type')
+	}
+	if isnil(ptr) {
+		panic(@MOD + '.' + @FN + ': could not get the elements of array ${ptr_str(arr)} in jni.Env (${ptr_str(env)})')
+	}
+	return ArrayElements[T]{
+		arr:     arr
+		is_copy: j2v_boolean(is_copy)
+		data:    unsafe { array_view[T](ptr, len) }
+	}
+}
+
+// release releases the elements. See `ReleaseMode` for the meaning of `mode`.
+// With `.commit` the elements stay valid and `release` has to be called again.
+pub fn (mut ae ArrayElements[T]) release(env &Env, mode ReleaseMode) {
+	if ae.released {
+		return
+	}
+	ptr := ae.data.data
+	m := jint(int(mode))
+	$if T is bool {
+		C.ReleaseBooleanArrayElements(env, ae.arr, &C.jboolean(ptr), m)
+	} $else $if T is u8 || T is i8 {
+		C.ReleaseByteArrayElements(env, ae.arr, &C.jbyte(ptr), m)
+	} $else $if T is u16 {
+		C.ReleaseCharArrayElements(env, ae.arr, &C.jchar(ptr), m)
+	} $else $if T is i16 {
+		C.ReleaseShortArrayElements(env, ae.arr, &C.jshort(ptr), m)
+	} $else $if T is int || T is i32 {
+		C.ReleaseIntArrayElements(env, ae.arr, &C.jint(ptr), m)
+	} $else $if T is i64 {
+		C.ReleaseLongArrayElements(env, ae.arr, &C.jlong(ptr), m)
+	} $else $if T is f32 {
+		C.ReleaseFloatArrayElements(env, ae.arr, &C.jfloat(ptr), m)
+	} $else $if T is f64 {
+		C.ReleaseDoubleArrayElements(env, ae.arr, &C.jdouble(ptr), m)
+	}
+	if mode != .commit {
+		ae.released = true
+		ae.data = []T{}
+	}
+}
+
+// array_descriptor returns the JNI type descriptor of the Java array type matching `T`, e.g. '[I'.
+fn array_descriptor[T]() string {
+	$if T is bool {
+		return '[Z'
+	} $else $if T is u8 || T is i8 {
+		return '[B'
+	} $else $if T is u16 {
+		return '[C'
+	} $else $if T is i16 {
+		return '[S'
+	} $else $if T is int || T is i32 {
+		return '[I'
+	} $else $if T is i64 {
+		return '[J'
+	} $else $if T is f32 {
+		return '[F'
+	} $else $if T is f64 {
+		return '[D'
+	} $else {
+		$compile_error('jni.array_descriptor: unsupported element type')
+	}
+	return ''
+}
+
+// array_view returns a V array *view* of `len` elements at `ptr`. The view does not own
+// the memory: it can't grow and is never freed by V. It is only valid as long as `ptr` is.
+@[unsafe]
+fn array_view[T](ptr voidptr, len int) []T {
+	mut view := []T{}
+	unsafe {
+		view.data = ptr
+		view.len = len
+		view.cap = len
+		view.flags.set(.noslices | .noshrink | .nogrow | .nofree)
+	}
+	return view
+}
@@ -0,0 +1,184 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+// Batched calls.
+//
+// A batch calls a prepared `CallSite` once per row of column-oriented arguments,
+// reusing the call site's `JavaValue` buffer, and stores the results in a preallocated array.
+// The calls run in chunks, each chunk inside one local reference frame.
+//
+// Example:
+// ```v
+// mut cs := jni.prepare_object_method(env, acc, 'add(int, f64) bool')
+// ids := []int{len: 10_000, init: index}
+// values := []f64{len: 10_000, init: index * 0.5}
+// mut added := []bool{len: ids.len}
+// res := cs.batch[bool](env, [jni.Column(ids), jni.Column(values)], mut added, jni.default_batch_chunk)
+// if !res.ok() {
+//	println('row ${res.failed} threw')
+// }
+// ```
+
+// default_batch_chunk is the default number of calls per local frame.
+pub const default_batch_chunk = 256
+
+// Column is one argument of every call in a batch.
+pub type Column = []JavaObject
+	| []bool
+	| []f32
+	| []f64
+	| []i16
+	| []i64
+	| []int
+	| []rune
+	| []string
+	| []u8
+
+// BatchResult is the outcome of a batch.
+pub struct BatchResult {
+pub:
+	calls     int           // number of calls that completed without throwing
+	failed    int = -1      // index of the call that threw, -1 if none did
+	exception JavaThrowable // the exception thrown (a local reference), the pending exception is cleared
+}
+
+// ok returns `true` if no call in the batch threw.
+@[inline]
+pub fn (br BatchResult) ok() bool {
+	return br.failed < 0
+}
+
+fn (c Column) len() int {
+	return match c {
+		[]JavaObject { c.len }
+		[]bool { c.len }
+		[]f32 { c.len }
+		[]f64 { c.len }
+		[]i16 { c.len }
+		[]i64 { c.len }
+		[]int { c.len }
+		[]rune { c.len }
+		[]string { c.len }
+		[]u8 { c.len }
+	}
+}
+
+@[direct_array_access; inline]
+fn (mut cs CallSite) set_column(env &Env, index int, c Column, row int) {
+	match c {
+		[]JavaObject { cs.set_object(index, c[row]) }
+		[]bool { cs.set_bool(index, c[row]) }
+		[]f32 { cs.set_f32(index, c[row]) }
+		[]f64 { cs.set_f64(index, c[row]) }
+		[]i16 { cs.set_i16(index, c[row]) }
+		[]i64 { cs.set_i64(index, c[row]) }
+		[]int { cs.set_int(index, c[row]) }
+		[]rune { cs.set_rune(index, c[row]) }
+		[]string { cs.set_string(env, index, c[row]) }
+		[]u8 { cs.set_u8(index, c[row]) }
+	}
+}
+
+// batch calls the prepared method once per row of `columns` (one column per argument)
+// and stores the result of row `i` in `results[i]`. Up to `chunk` calls share a local frame.
+// Use `batch_void` for `void` methods.
+// Object results (`R` is `JavaObject`) are local references in the caller's frame,
+// so batches returning objects run without a local frame.
+// The batch stops at the first call that throws, see `BatchResult`.
+// A method without arguments is called `results.len` times.
+pub fn (mut cs CallSite) batch[R](env &Env, columns []Column, mut results []R, chunk int) BatchResult {
+	$if R is Void {
+		$compile_error('jni.CallSite.batch: use batch_void for void methods')
+	}
+	n := if columns.len > 0 { columns[0].len() } else { results.len }
+	if results.len < n {
+		panic(@MOD + '.' + @FN + ': room for ${results.len} results, need ${n}')
+	}
+	return cs.batch_rows[R](env, columns, n, mut results, chunk)
+}
+
+// batch_void calls the prepared `void` method `rows` times, with the arguments of each row
+// taken from `columns`, see `batch`. `rows` must be the length of the columns, if any.
+pub fn (mut cs CallSite) batch_void(env &Env, columns []Column, rows int, chunk int) BatchResult {
+	mut results := []Void{}
+	return cs.batch_rows[Void](env, columns, rows, mut results, chunk)
+}
+
+fn (mut cs CallSite) batch_rows[R](env &Env, columns []Column, n int, mut results []R, chunk int) BatchResult {
+	$if debug {
+		check_not_critical(@FN)
+	}
+	if columns.len != cs.arg_kinds.len {
+		panic(@MOD + '.' + @FN + ': "${cs.signature}" takes ${cs.arg_kinds.len} arguments, got ${columns.len} columns')
+	}
+	for c in columns {
+		if c.len() != n {
+			panic(@MOD + '.' + @FN + ': all columns must have ${n} rows')
+		}
+	}
+	step := if chunk > 0 { chunk } else { default_batch_chunk }
+	for start := 0; start < n; start += step {
+		end := if start + step < n { start + step } else { n }
+		$if R is JavaObject {
+		} $else {
+			local_frame(env, (end - start) * columns.len + 1)
+		}
+		for i in start .. end {
+			for c, column in columns {
+				cs.set_column(env, c, column, i)
+			}
+			$if R is Void {
+				cs.call_void(env)
+			} $else $if R is bool {
+				results[i] = cs.call_bool(env)
+			} $else $if R is u8 {
+				results[i] = cs.call_u8(env)
+			} $else $if R is rune {
+				results[i] = cs.call_rune(env)
+			} $else $if R is i16 {
+				results[i] = cs.call_i16(env)
+			} $else $if R is int {
+				results[i] = cs.call_int(env)
+			} $else $if R is i64 {
+				results[i] = cs.call_i64(env)
+			} $else $if R is f32 {
+				results[i] = cs.call_f32(env)
+			} $else $if R is f64 {
+				results[i] = cs.call_f64(env)
+			} $else $if R is string {
+				results[i] = cs.call_string(env)
+			} $else $if R is JavaObject {
+				results[i] = cs.call_object(env)
+				// Without a frame the argument strings have to go one by one, before
+				// the exception check so the strings of a failing row go too
+				cs.release_strings(env)
+			} $else {
+				$compile_error('jni.CallSite.batch: unsupported result type')
+			}
+			// No JNI function, including the next call, may be made with an exception pending
+			if exception_check(env) {
+				mut exception := exception_occurred(env)
+				exception_clear(env)
+				$if R is JavaObject {
+				} $else {
+					exception = JavaThrowable(pop_local_frame(env, JavaObject(exception)))
+					cs.forget_strings()
+				}
+				return BatchResult{
+					calls:     i
+					failed:    i
+					exception: exception
+				}
+			}
+		}
+		$if R is JavaObject {
+		} $else {
+			pop_local_frame(env, JavaObject(unsafe { nil }))
+			cs.forget_strings()
+		}
+	}
+	return BatchResult{
+		calls: n
+	}
+}
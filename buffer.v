@@ -0,0 +1,180 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import sync
+
+// Direct `java.nio.ByteBuffer`s.
+//
+// A `DirectBuffer` is V memory exposed to Java as a direct `ByteBuffer`, so the same
+// bytes can be read and written from both sides without copying.
+// Java may keep the `ByteBuffer` around after V is done with it, so the memory
+// is not freed by `free` but handed over to a pending list, and only freed by
+// `collect_direct_buffers` once the Java garbage collector has collected the `ByteBuffer`.
+//
+// Example:
+// ```v
+// mut db := jni.new_direct_buffer(env, 4 * 1024 * 1024, 64)
+// encode_into(mut db.data)
+// jni.call_static_method(env, 'io.vlang.Net.send(java.nio.ByteBuffer)', db.buffer)
+// db.free(env)
+// // ... later, e.g. once per frame
+// jni.collect_direct_buffers(env)
+// ```
+
+// DirectBuffer is memory shared with Java as a direct `java.nio.ByteBuffer`.
+pub struct DirectBuffer {
+pub:
+	data   []u8       // view of the buffer memory
+	buffer JavaObject // the `ByteBuffer` (a global ref)
+mut:
+	base  voidptr    // allocation owned by the buffer, `nil` if the memory is not owned
+	weak  JavaObject // weak ref to `buffer` once freed
+	freed bool
+}
+
+struct PendingBuffer {
+	weak JavaObject
+	base voidptr
+}
+
+// DirectBuffers holds freed direct buffers that Java may still reference.
+struct DirectBuffers {
+mut:
+	mutex   &sync.RwMutex = sync.new_rwmutex()
+	pending []PendingBuffer
+}
+
+fn direct_buffers() &DirectBuffers {
+	mut db := unsafe { &DirectBuffers(state(.direct_buffers)) }
+	if isnil(db) {
+		db = unsafe { &DirectBuffers(set_state_once(.direct_buffers, &DirectBuffers{})) }
+	}
+	return db
+}
+
+// new_direct_buffer allocates `size` zeroed bytes aligned to `align` (a power of 2)
+// and wraps them in a direct `ByteBuffer`. The memory is owned by the returned buffer.
+pub fn new_direct_buffer(env &Env, size int, align int) DirectBuffer {
+	// Checked in all builds, a bad alignment would silently misalign the buffer
+	if align <= 0 || align & (align - 1) != 0 {
+		panic(@MOD + '.' + @FN + ': alignment ${align} is not a power of 2')
+	}
+	base := unsafe { vcalloc_noscan(size + align) }
+	addr := voidptr((usize(base) + usize(align - 1)) & ~usize(align - 1))
+	mut db := wrap_direct_buffer(env, unsafe { array_view[u8](addr, size) })
+	db.base = base
+	return db
+}
+
+// wrap_direct_buffer wraps `data`, e.g. a slice of an arena, in a direct `ByteBuffer`.
+// The memory is *not* owned by the returned buffer; it must stay valid until `in_use` returns `false`
+// after the buffer has been freed.
+pub fn wrap_direct_buffer(env &Env, data []u8) DirectBuffer {
+	local := new_direct_byte_buffer(env, data.data, data.len)
+	if isnil(local) {
+		$if debug {
+			exception_describe(env)
+		}
+		panic(@MOD + '.' + @FN + ': could not create a direct ByteBuffer of ${data.len} bytes in jni.Env (${ptr_str(env)})')
+	}
+	buffer := new_global_ref(env, local)
+	delete_local_ref(env, local)
+	return DirectBuffer{
+		data:   data
+		buffer: buffer
+	}
+}
+
+// free releases V's reference to the `ByteBuffer`.
+// The memory is freed by `collect_direct_buffers` once Java no longer references the `ByteBuffer`.
+pub fn (mut db DirectBuffer) free(env &Env) {
+	if db.freed {
+		return
+	}
+	db.freed = true
+	db.weak = new_weak_global_ref(env, db.buffer)
+	delete_global_ref(env, db.buffer)
+	mut dbs := direct_buffers()
+	dbs.mutex.@lock()
+	dbs.pending << PendingBuffer{
+		weak: db.weak
+		base: db.base
+	}
+	dbs.mutex.unlock()
+	db.base = unsafe { nil }
+}
+
+// in_use returns `true` if the `ByteBuffer` of `db` may still be referenced by Java.
+pub fn (db &DirectBuffer) in_use(env &Env) bool {
+	if !db.freed {
+		return true
+	}
+	mut dbs := direct_buffers()
+	dbs.mutex.@rlock()
+	defer {
+		dbs.mutex.runlock()
+	}
+	for p in dbs.pending {
+		if p.weak == db.weak {
+			return !is_same_object(env, p.weak, JavaObject(unsafe { nil }))
+		}
+	}
+	// Collected
+	return false
+}
+
+// collect_direct_buffers frees the memory of freed direct buffers that Java
+// has garbage collected and returns the number of buffers collected.
+pub fn collect_direct_buffers(env &Env) int {
+	mut dbs := direct_buffers()
+	dbs.mutex.@lock()
+	defer {
+		dbs.mutex.unlock()
+	}
+	mut kept := []PendingBuffer{cap: dbs.pending.len}
+	mut collected := 0
+	for p in dbs.pending {
+		if !is_same_object(env, p.weak, JavaObject(unsafe { nil })) {
+			kept << p
+			continue
+		}
+		delete_weak_global_ref(env, p.weak)
+		if !isnil(p.base) {
+			unsafe { free(p.base) }
+		}
+		collected++
+	}
+	dbs.pending = kept
+	return collected
+}
+
+// free_direct_buffers frees all pending direct buffers, referenced or not.
+// It is only safe to call when the JavaVM is going away, see `on_unload`.
+fn free_direct_buffers(env &Env) {
+	mut dbs := direct_buffers()
+	dbs.mutex.@lock()
+	for p in dbs.pending {
+		delete_weak_global_ref(env, p.weak)
+		if !isnil(p.base) {
+			unsafe { free(p.base) }
+		}
+	}
+	dbs.pending.clear()
+	dbs.mutex.unlock()
+}
+
+// direct_buffer_view returns a view of the memory of the direct `ByteBuffer` `buf`.
+// It panics if `buf` is not a direct buffer or if its capacity is less than `min_len` bytes.
+// The view is only valid as long as Java keeps `buf` alive.
+pub fn direct_buffer_view(env &Env, buf JavaObject, min_len int) []u8 {
+	addr := get_direct_buffer_address(env, buf)
+	if isnil(addr) {
+		panic(@MOD + '.' + @FN + ': ${ptr_str(buf)} is not a direct buffer')
+	}
+	capacity := get_direct_buffer_capacity(env, buf)
+	if capacity < min_len || capacity > max_i32 {
+		panic(@MOD + '.' + @FN + ': direct buffer ${ptr_str(buf)} has a capacity of ${capacity} bytes, need at least ${min_len}')
+	}
+	return unsafe { array_view[u8](addr, int(capacity)) }
+}
@@ -2,6 +2,15 @@
 // Use of this source code is governed by an MIT license file distributed with this software package
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 #ifdef V_ANDROID_LOG_PRINT
 	#ifdef __ANDROID__
@@ -19,6 +28,15 @@ static JavaVM* gJavaVM;
 static jobject gClassLoader;
 static jmethodID gFindClassMethod;
 
+// Slots for lazily created, process-wide V state (caches, registries etc.).
+// V consts can't be used for this since `JNI_OnLoad` is called by the Java VM
+// before the V init code of the library has run.
+#define V_JNI_STATE_SLOTS 16
+static void* gStateSlots[V_JNI_STATE_SLOTS];
+
+// Number of critical regions (Get*Critical) currently held by the calling thread.
+static _Thread_local int gCriticalRegions;
+
 void __v_jni_log_i(const char *fmt, ...) {
 	va_list args;
     va_start(args, fmt);
@@ -76,87 +94,462 @@ JavaVM* gGetJavaVM() {
 	return gJavaVM;
 }
 
-// Utility function to get JNIEnv
-JNIEnv* gGetEnv() {
-	JNIEnv *env;
-	if (gJavaVM == 0) {
-		__v_jni_log_e("jni.c: (gGetEnv) Invalid global Java VM");
-		return 0;
+void* gGetState(int slot) {
+	return __atomic_load_n(&gStateSlots[slot], __ATOMIC_ACQUIRE);
+}
+
+// gSetStateOnce publishes `state` in `slot` if it is empty and returns
+// whatever state ends up in the slot.
+void* gSetStateOnce(int slot, void* state) {
+	void* expected = 0;
+	if (__atomic_compare_exchange_n(&gStateSlots[slot], &expected, state, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		return state;
 	}
+	return expected;
+}
 
-	int status;
-	status = (*gJavaVM)->GetEnv(gJavaVM,(void **) &env, JNI_VERSION_1_6);
+void* gLoadOnce(void** ptr) {
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
 
-	if (status < 0) {
-		__v_jni_log_i("jni.c: Attaching thread to get JNI environment from Java VM %p", gJavaVM);
-		// Try to attach native thread to JVM:
-		status = (*gJavaVM)->AttachCurrentThread(gJavaVM, &env, 0);
-		if (status < 0) {
-			__v_jni_log_e("jni.c: Failed to attach current thread to Java VM %p", gJavaVM);
-			return 0;
-		}
-		__v_jni_log_i("jni.c: Attached to thread successfully");
+// gPublishOnce stores `value` in `*ptr` if it is empty and returns whatever
+// ends up in `*ptr`, like `gSetStateOnce` for pointers outside the state slots.
+void* gPublishOnce(void** ptr, void* value) {
+	void* expected = 0;
+	if (__atomic_compare_exchange_n(ptr, &expected, value, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		return value;
 	}
+	return expected;
+}
 
-	return env;
+void gCriticalEnter() {
+	gCriticalRegions++;
 }
 
-/*
-gEnvNeedDetach allows you to see if the VM needs detach when you're done
-using the JNIEnv. In the real world this isn't very nice to work with since
-all calls retrieving a JNIEnv pointer need to check the need_detach and detach
-the current thread accordingly...
+void gCriticalExit() {
+	gCriticalRegions--;
+}
 
-Example usage of gEnvNeedDetach:
+int gCriticalRegionsHeld() {
+	return gCriticalRegions;
+}
 
-jclass gFindClass(const char *name) {
-	JNIEnv *env;
-	bool need_detach = gEnvNeedDetach(&env);
+// Local reference accounting for `-d jni_stats` (see stats.v).
+// The V wrappers that create or delete local references report them here, per thread,
+// and the highest count seen by any thread is kept. Frames restore the count they started with.
+#define V_JNI_STATS_MAX_FRAMES 64
+static _Thread_local int gLocalRefs;
+static _Thread_local int gLocalFrameDepth;
+static _Thread_local int gLocalFrameBase[V_JNI_STATS_MAX_FRAMES];
+static int gLocalRefsHighWater;
 
-	jclass clz = (*env)->CallObjectMethod(env, gClassLoader, gFindClassMethod, (*env)->NewStringUTF(env, name));
+void gStatsLocalRefs(int delta) {
+	gLocalRefs += delta;
+	if (gLocalRefs < 0) {
+		// Deleted a reference that was created outside the wrappers
+		gLocalRefs = 0;
+	}
+	int hw = __atomic_load_n(&gLocalRefsHighWater, __ATOMIC_RELAXED);
+	while (gLocalRefs > hw && !__atomic_compare_exchange_n(&gLocalRefsHighWater, &hw, gLocalRefs, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
 
-	if (need_detach) {
-		JavaVM *vm = gGetJavaVM();
-        (*vm)->DetachCurrentThread(vm);
-    }
+void gStatsPushFrame() {
+	if (gLocalFrameDepth < V_JNI_STATS_MAX_FRAMES) {
+		gLocalFrameBase[gLocalFrameDepth] = gLocalRefs;
+	}
+	gLocalFrameDepth++;
+}
 
-	return clz;
+void gStatsPopFrame(int kept) {
+	if (gLocalFrameDepth == 0) {
+		return;
+	}
+	gLocalFrameDepth--;
+	if (gLocalFrameDepth < V_JNI_STATS_MAX_FRAMES) {
+		gLocalRefs = gLocalFrameBase[gLocalFrameDepth];
+	}
+	gStatsLocalRefs(kept);
 }
-*/
-bool gEnvNeedDetach(JNIEnv **env) {
+
+int gStatsLocalRefsHighWater() {
+	return __atomic_load_n(&gLocalRefsHighWater, __ATOMIC_RELAXED);
+}
+
+void gStatsResetLocalRefs() {
+	__atomic_store_n(&gLocalRefsHighWater, gLocalRefs, __ATOMIC_RELAXED);
+}
+
+void gStatsMax(uint64_t* max, uint64_t value) {
+	uint64_t m = __atomic_load_n(max, __ATOMIC_RELAXED);
+	while (value > m && !__atomic_compare_exchange_n(max, &m, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+// Per thread JNIEnv cache.
+// A thread attached by `gGetEnv`/`gAttachThread` is attached as a daemon and
+// detached automatically when it exits: via the destructor of `gEnvKey` with pthreads,
+// via the callback of the fiber local storage slot `gEnvFls` on Windows.
+static _Thread_local JNIEnv* gThreadEnv;
+static _Thread_local bool gThreadAttached;
+static unsigned long long gAttachCount;
+static unsigned long long gDetachCount;
+
+static void gDetachAtExit(void* value) {
+	(void)value;
+	if (gJavaVM != 0) {
+		(*gJavaVM)->DetachCurrentThread(gJavaVM);
+		__atomic_add_fetch(&gDetachCount, 1, __ATOMIC_RELAXED);
+	}
+}
+
+#ifdef _WIN32
+static DWORD gEnvFls = FLS_OUT_OF_INDEXES;
+static INIT_ONCE gEnvFlsOnce = INIT_ONCE_STATIC_INIT;
+
+// FLS callbacks run at thread exit before DLL_THREAD_DETACH, outside the loader lock.
+static void NTAPI gEnvFlsCallback(void* value) {
+	gDetachAtExit(value);
+}
+
+static BOOL CALLBACK gMakeEnvFls(PINIT_ONCE once, PVOID param, PVOID *ctx) {
+	(void)once; (void)param; (void)ctx;
+	gEnvFls = FlsAlloc(gEnvFlsCallback);
+	return TRUE;
+}
+#else
+static pthread_key_t gEnvKey;
+static pthread_once_t gEnvKeyOnce = PTHREAD_ONCE_INIT;
+
+static void gMakeEnvKey() {
+	pthread_key_create(&gEnvKey, gDetachAtExit);
+}
+#endif
+
+// gSetDetachAtExit makes the calling thread detach at exit (`env` != 0) or not (`env` == 0).
+static void gSetDetachAtExit(JNIEnv* env) {
+	#ifdef _WIN32
+	InitOnceExecuteOnce(&gEnvFlsOnce, gMakeEnvFls, NULL, NULL);
+	if (gEnvFls != FLS_OUT_OF_INDEXES) {
+		FlsSetValue(gEnvFls, env);
+	}
+	#else
+	pthread_once(&gEnvKeyOnce, gMakeEnvKey);
+	// Any non-null value makes the destructor run at thread exit
+	pthread_setspecific(gEnvKey, env);
+	#endif
+}
+
+// gAttachThread returns the JNIEnv of the calling thread, attaching it to the
+// Java VM as a daemon thread named `name` if it isn't attached yet.
+JNIEnv* gAttachThread(const char *name) {
+	if (gThreadEnv != 0) {
+		return gThreadEnv;
+	}
 	if (gJavaVM == 0) {
-		__v_jni_log_e("jni.c: (gGetEnvShouldDetach) Invalid global Java VM");
+		__v_jni_log_e("jni.c: (gAttachThread) Invalid global Java VM");
 		return 0;
 	}
-	// Get current thread JNI environment
-	JavaVM *vm = gGetJavaVM();
-	*env = NULL;
 
-	if ((*vm)->GetEnv(vm, (void**)env, JNI_VERSION_1_6) == JNI_OK) {
-		return false;
+	JNIEnv *env = 0;
+	if ((*gJavaVM)->GetEnv(gJavaVM, (void **) &env, JNI_VERSION_1_6) == JNI_OK) {
+		// A Java thread or a thread attached by someone else, it is not ours to detach
+		gThreadEnv = env;
+		return env;
 	}
 
 	JavaVMAttachArgs args = {
-		.version  = JNI_VERSION_1_6,
-		.name = "NativeThread",
+		.version = JNI_VERSION_1_6,
+		.name = (char *) name,
 		.group = NULL
 	};
+	if ((*gJavaVM)->AttachCurrentThreadAsDaemon(gJavaVM, (void **) &env, &args) != JNI_OK) {
+		__v_jni_log_e("jni.c: Failed to attach current thread to Java VM %p", gJavaVM);
+		return 0;
+	}
+	__atomic_add_fetch(&gAttachCount, 1, __ATOMIC_RELAXED);
+	__v_jni_log_d("jni.c: Attached thread \"%s\" to Java VM %p", name, gJavaVM);
+	gThreadEnv = env;
+	gThreadAttached = true;
+	gSetDetachAtExit(env);
+	return env;
+}
 
-	if ((*vm)->AttachCurrentThread(vm, env, &args) != JNI_OK) {
-		return false;
+// gEnvOf returns the JNIEnv of the calling thread in `vm`, or 0 if the thread is not attached.
+// Unlike `gGetEnv` it never attaches the thread.
+JNIEnv* gEnvOf(JavaVM* vm) {
+	JNIEnv *env = 0;
+	if (vm == 0 || (*vm)->GetEnv(vm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
+		return 0;
+	}
+	return env;
+}
+
+// Utility function to get JNIEnv
+JNIEnv* gGetEnv() {
+	if (gThreadEnv != 0) {
+		return gThreadEnv;
 	}
+	return gAttachThread("V native thread");
+}
 
-	return true;
+/*
+gEnvNeedDetach used to attach the calling thread and report if it had to be
+detached again when done with the JNIEnv. Threads are now attached once and
+detached automatically at thread exit, so it always reports `false`.
+*/
+bool gEnvNeedDetach(JNIEnv **env) {
+	*env = gGetEnv();
+	return false;
 }
 
+// gDetachThread detaches the calling thread if it was attached by `gAttachThread`.
 void gDetachThread() {
-	JavaVM *vm = gGetJavaVM();
-	(*vm)->DetachCurrentThread(vm);
+	if (!gThreadAttached || gJavaVM == 0) {
+		return;
+	}
+	(*gJavaVM)->DetachCurrentThread(gJavaVM);
+	__atomic_add_fetch(&gDetachCount, 1, __ATOMIC_RELAXED);
+	gThreadEnv = 0;
+	gThreadAttached = false;
+	gSetDetachAtExit(0);
+}
+
+#ifdef V_JNI_HOST
+// Embedded Java VM, used by the `jni.host` module (which defines V_JNI_HOST and links libjvm).
+
+// gCreateJavaVM creates a Java VM in this process with the `n` option strings in `options`
+// and makes it the global Java VM. The calling thread is attached by the VM itself.
+jint gCreateJavaVM(jint version, char **options, int n, jboolean ignore_unrecognized, JNIEnv **env) {
+	JavaVMOption *opts = (JavaVMOption *) calloc(n > 0 ? n : 1, sizeof(JavaVMOption));
+	if (opts == 0) {
+		return JNI_ENOMEM;
+	}
+	for (int i = 0; i < n; i++) {
+		opts[i].optionString = options[i];
+	}
+	JavaVMInitArgs args = {
+		.version = version,
+		.nOptions = n,
+		.options = opts,
+		.ignoreUnrecognized = ignore_unrecognized
+	};
+	JavaVM *vm = 0;
+	jint res = JNI_CreateJavaVM(&vm, (void **) env, &args);
+	free(opts);
+	if (res != JNI_OK) {
+		__v_jni_log_e("jni.c: (gCreateJavaVM) JNI_CreateJavaVM failed (%d)", res);
+		return res;
+	}
+	__v_jni_log_d("jni.c: Created Java VM %p", vm);
+	gJavaVM = vm;
+	// Attached by the VM, not ours to detach
+	gThreadEnv = *env;
+	gThreadAttached = false;
+	return JNI_OK;
+}
+
+// gCreatedJavaVM returns the Java VM already created in this process or 0.
+JavaVM* gCreatedJavaVM() {
+	JavaVM *vm = 0;
+	jsize n = 0;
+	if (JNI_GetCreatedJavaVMs(&vm, 1, &n) != JNI_OK || n == 0) {
+		return 0;
+	}
+	return vm;
+}
+
+// gDestroyJavaVM unloads the global Java VM, after all non-daemon Java threads have finished.
+jint gDestroyJavaVM() {
+	if (gJavaVM == 0) {
+		return JNI_ERR;
+	}
+	JavaVM *vm = gJavaVM;
+	jint res = (*vm)->DestroyJavaVM(vm);
+	__v_jni_log_d("jni.c: Destroyed Java VM %p (%d)", vm, res);
+	gJavaVM = 0;
+	gThreadEnv = 0;
+	gThreadAttached = false;
+	return res;
 }
+#endif
+
+unsigned long long gAttachCountGet() {
+	return __atomic_load_n(&gAttachCount, __ATOMIC_RELAXED);
+}
+
+unsigned long long gDetachCountGet() {
+	return __atomic_load_n(&gDetachCount, __ATOMIC_RELAXED);
+}
+
+// Process-wide registry of global class references, keyed by the name they were looked up by.
+// Lookups are lock-free: entries are published with a release store of their name and
+// tables are never freed while in use (a grown table keeps the smaller one it replaced).
+// Inserts are rare and serialized by a spin lock.
+typedef struct {
+	char* name;
+	int len;
+	unsigned int hash;
+	jclass cls;
+} gClassEntry;
 
+typedef struct gClassTable {
+	unsigned int cap; // power of 2
+	unsigned int count;
+	gClassEntry* entries;
+	struct gClassTable* retired;
+} gClassTable;
+
+static gClassTable* gClasses;
+static int gClassesLock;
+
+// Class names are compared with '.' and '/' as the same character, so 'a.b.C' and 'a/b/C'
+// share one entry without converting names on lookups.
+#define gClassChar(c) ((c) == '.' ? '/' : (c))
+
+static unsigned int gClassHash(const char* name, int len) {
+	unsigned int h = 2166136261u;
+	for (int i = 0; i < len; i++) {
+		h = (h ^ (unsigned char)gClassChar(name[i])) * 16777619u;
+	}
+	return h;
+}
+
+// gClassSame returns 1 if the registered (slash separated) `key` names the class `name`.
+static int gClassSame(const char* key, const char* name, int len) {
+	for (int i = 0; i < len; i++) {
+		if (key[i] != gClassChar(name[i])) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static jclass gClassFind(gClassTable* t, const char* name, int len, unsigned int hash) {
+	unsigned int mask = t->cap - 1;
+	for (unsigned int i = hash & mask;; i = (i + 1) & mask) {
+		gClassEntry* e = &t->entries[i];
+		char* n = __atomic_load_n(&e->name, __ATOMIC_ACQUIRE);
+		if (n == 0) {
+			return 0;
+		}
+		if (e->hash == hash && e->len == len && gClassSame(n, name, len)) {
+			return e->cls;
+		}
+	}
+}
+
+static void gClassInsert(gClassTable* t, char* name, int len, unsigned int hash, jclass cls) {
+	unsigned int mask = t->cap - 1;
+	unsigned int i = hash & mask;
+	while (t->entries[i].name != 0) {
+		i = (i + 1) & mask;
+	}
+	t->entries[i].len = len;
+	t->entries[i].hash = hash;
+	t->entries[i].cls = cls;
+	__atomic_store_n(&t->entries[i].name, name, __ATOMIC_RELEASE);
+	t->count++;
+}
+
+// gClassGet returns the registered class `name` or 0.
+jclass gClassGet(const char* name, int len) {
+	gClassTable* t = __atomic_load_n(&gClasses, __ATOMIC_ACQUIRE);
+	if (t == 0) {
+		return 0;
+	}
+	return gClassFind(t, name, len, gClassHash(name, len));
+}
+
+// gClassPut registers the global class reference `cls` as `name` and returns
+// the registered class, which is not `cls` if another thread registered `name` first.
+jclass gClassPut(const char* name, int len, jclass cls) {
+	unsigned int hash = gClassHash(name, len);
+	while (__atomic_exchange_n(&gClassesLock, 1, __ATOMIC_ACQUIRE)) {}
+	gClassTable* t = gClasses;
+	if (t != 0) {
+		jclass existing = gClassFind(t, name, len, hash);
+		if (existing != 0) {
+			__atomic_store_n(&gClassesLock, 0, __ATOMIC_RELEASE);
+			return existing;
+		}
+	}
+	if (t == 0 || (t->count + 1) * 2 > t->cap) {
+		gClassTable* grown = calloc(1, sizeof(gClassTable));
+		grown->cap = t == 0 ? 64 : t->cap * 2;
+		grown->entries = calloc(grown->cap, sizeof(gClassEntry));
+		grown->retired = t;
+		if (t != 0) {
+			for (unsigned int i = 0; i < t->cap; i++) {
+				gClassEntry* e = &t->entries[i];
+				if (e->name != 0) {
+					gClassInsert(grown, e->name, e->len, e->hash, e->cls);
+				}
+			}
+		}
+		__atomic_store_n(&gClasses, grown, __ATOMIC_RELEASE);
+		t = grown;
+	}
+	char* key = malloc(len + 1);
+	for (int i = 0; i < len; i++) {
+		key[i] = gClassChar(name[i]);
+	}
+	key[len] = 0;
+	gClassInsert(t, key, len, hash, cls);
+	__atomic_store_n(&gClassesLock, 0, __ATOMIC_RELEASE);
+	return cls;
+}
+
+// gClassClear deletes all registered global class references.
+// No lookups may run concurrently, it is meant for `JNI_OnUnload`.
+void gClassClear(JNIEnv* env) {
+	while (__atomic_exchange_n(&gClassesLock, 1, __ATOMIC_ACQUIRE)) {}
+	gClassTable* t = gClasses;
+	__atomic_store_n(&gClasses, 0, __ATOMIC_RELEASE);
+	if (t != 0) {
+		for (unsigned int i = 0; i < t->cap; i++) {
+			gClassEntry* e = &t->entries[i];
+			if (e->name != 0) {
+				(*env)->DeleteGlobalRef(env, e->cls);
+				free(e->name);
+			}
+		}
+	}
+	while (t != 0) {
+		gClassTable* retired = t->retired;
+		free(t->entries);
+		free(t);
+		t = retired;
+	}
+	__atomic_store_n(&gClassesLock, 0, __ATOMIC_RELEASE);
+}
+
+// gRegisterNatives registers `n` native methods on `cls` in one `RegisterNatives` call.
+jint gRegisterNatives(JNIEnv* env, jclass cls, char** names, char** signatures, void** fns, int n) {
+	JNINativeMethod* methods = malloc(n * sizeof(JNINativeMethod));
+	for (int i = 0; i < n; i++) {
+		methods[i].name = names[i];
+		methods[i].signature = signatures[i];
+		methods[i].fnPtr = fns[i];
+	}
+	jint status = (*env)->RegisterNatives(env, cls, methods, n);
+	free(methods);
+	return status;
+}
+
+// gFindClass looks `name` up with the class loader of the application, set by `gSetupAndroid`.
+// Before that, e.g. in `JNI_OnLoad`, it falls back to `FindClass`, which there uses the
+// class loader of the library.
 jclass gFindClass(const char *name) {
 	JNIEnv *env = gGetEnv();
-	return (*env)->CallObjectMethod(env, gClassLoader, gFindClassMethod, (*env)->NewStringUTF(env, name));
+	jmethodID findClass = __atomic_load_n(&gFindClassMethod, __ATOMIC_ACQUIRE);
+	if (findClass == NULL) {
+		return (*env)->FindClass(env, name);
+	}
+	jstring jname = (*env)->NewStringUTF(env, name);
+	jclass clz = (*env)->CallObjectMethod(env, gClassLoader, findClass, jname);
+	(*env)->DeleteLocalRef(env, jname);
+	return clz;
 }
 
 void gSetupAndroid(const char *fqActivityName) {
@@ -181,7 +574,9 @@ void gSetupAndroid(const char *fqActivityName) {
 	gClassLoader = (*env)->NewGlobalRef(env, (*env)->CallObjectMethod(env, randomClass, getClassLoaderMethod));
 	__v_jni_log_d("jni.c.gSetupAndroid() gClassLoader %p", gClassLoader);
 	if (ExceptionCheck(env) == JNI_TRUE) { ExceptionDescribe(env); }
-	gFindClassMethod = (*env)->GetMethodID(env, classLoaderClass, "findClass", "(Ljava/lang/String;)Ljava/lang/Class;");
+	// Published last, `gFindClass` uses the class loader once it sees the method
+	jmethodID findClass = (*env)->GetMethodID(env, classLoaderClass, "findClass", "(Ljava/lang/String;)Ljava/lang/Class;");
+	__atomic_store_n(&gFindClassMethod, findClass, __ATOMIC_RELEASE);
 	__v_jni_log_d("jni.c.gSetupAndroid() GetMethodID %d", gFindClassMethod);
 	if (ExceptionCheck(env) == JNI_TRUE) { ExceptionDescribe(env); }
 	#endif
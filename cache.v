@@ -0,0 +1,538 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import sync
+import sync.stdatomic
+
+// max_object_entries limits how many receiver classes are remembered per object method signature.
+const max_object_entries = 8
+
+// MethodCacheEntry is a resolved method. `class` is a global reference.
+struct MethodCacheEntry {
+	class       JavaClass
+	mid         JavaMethodID
+	ret         ValueKind
+	args        string      // the argument descriptor the method was resolved with, e.g. `ILjava/lang/String;`
+	arg_classes []JavaClass // global refs, see `args_descriptor`
+}
+
+// TypedMethod is a method resolved for the statically typed calls (see generic.v).
+struct TypedMethod {
+	class string // the class name given to `call_static<n>`, empty for object methods
+	desc  string // the Java method descriptor, e.g. `(ZI)V`
+	entry MethodCacheEntry
+}
+
+// MethodCache maps V `jni` style signatures to resolved Java methods.
+// The Java descriptor of a call depends on the types of its arguments, so each signature
+// can have an entry per argument descriptor (and per receiver class for object methods).
+// Entry lists are replaced, never changed in place, so lookups check a snapshot
+// of them without holding the lock while calling into the JavaVM.
+// The statically typed calls look their methods up by name, class and descriptor,
+// so a cache hit does not need to build a key.
+struct MethodCache {
+mut:
+	mutex         &sync.RwMutex = sync.new_rwmutex()
+	statics       map[string][]MethodCacheEntry
+	objects       map[string][]MethodCacheEntry
+	typed_statics map[string][]TypedMethod // by method name
+	typed_objects map[string][]TypedMethod // by method name
+	hits          u64
+	misses        u64
+}
+
+pub struct MethodCacheStats {
+pub:
+	hits   u64
+	misses u64
+	size   int
+}
+
+fn method_cache() &MethodCache {
+	mut mc := unsafe { &MethodCache(state(.method_cache)) }
+	if isnil(mc) {
+		mc = unsafe { &MethodCache(set_state_once(.method_cache, &MethodCache{})) }
+	}
+	return mc
+}
+
+// method_cache_stats returns the hit/miss counters of the method cache.
+pub fn method_cache_stats() MethodCacheStats {
+	mut mc := method_cache()
+	mc.mutex.@rlock()
+	size := mc.statics.len + mc.objects.len + mc.typed_statics.len + mc.typed_objects.len
+	mc.mutex.runlock()
+	return MethodCacheStats{
+		hits:   stdatomic.load_u64(&mc.hits)
+		misses: stdatomic.load_u64(&mc.misses)
+		size:   size
+	}
+}
+
+// clear_method_cache deletes all cached global class references and method IDs.
+pub fn clear_method_cache(env &Env) {
+	mut mc := method_cache()
+	mc.mutex.@lock()
+	// The classes of static entries are owned by the class registry
+	for _, entries in mc.statics {
+		for entry in entries {
+			release_arg_classes(env, entry.arg_classes)
+		}
+	}
+	for _, entries in mc.objects {
+		for entry in entries {
+			delete_global_ref(env, JavaObject(entry.class))
+			release_arg_classes(env, entry.arg_classes)
+		}
+	}
+	for _, methods in mc.typed_objects {
+		for method in methods {
+			delete_global_ref(env, JavaObject(method.entry.class))
+		}
+	}
+	mc.statics.clear()
+	mc.objects.clear()
+	mc.typed_statics.clear()
+	mc.typed_objects.clear()
+	mc.mutex.unlock()
+	stdatomic.store_u64(&mc.hits, 0)
+	stdatomic.store_u64(&mc.misses, 0)
+}
+
+@[inline]
+fn (mut mc MethodCache) hit() {
+	stdatomic.add_u64(&mc.hits, 1)
+}
+
+@[inline]
+fn (mut mc MethodCache) miss() {
+	stdatomic.add_u64(&mc.misses, 1)
+}
+
+// args_descriptor returns the Java argument descriptor for `args`, e.g. `ILjava/lang/String;`,
+// and global references to the classes of the `JavaObject` arguments (`nil` for other arguments,
+// none at all without `JavaObject` arguments). Cache entries keep the classes, so that a cache
+// hit checks an object argument with one `IsInstanceOf` instead of looking up its descriptor.
+fn args_descriptor(env &Env, args []Type) (string, []JavaClass) {
+	mut jargs := ''
+	mut classes := []JavaClass{}
+	for i, vt in args {
+		if vt is JavaObject {
+			cls := get_object_class(env, vt)
+			jargs += class_descriptor(env, cls)
+			if classes.len == 0 {
+				classes = []JavaClass{len: args.len}
+			}
+			classes[i] = JavaClass(new_global_ref(env, JavaObject(cls)))
+			delete_local_ref(env, JavaObject(cls))
+		} else {
+			jargs += v2j_signature_type(env, vt)
+		}
+	}
+	return jargs, classes
+}
+
+// release_arg_classes deletes the class references returned by `args_descriptor`.
+fn release_arg_classes(env &Env, classes []JavaClass) {
+	for cls in classes {
+		if !isnil(cls) {
+			delete_global_ref(env, JavaObject(cls))
+		}
+	}
+}
+
+// args_match returns `true` if `args` fit the argument descriptor `desc` and the argument
+// classes `classes` an entry was resolved with (see `args_descriptor`).
+// It does not allocate or call Java methods; a `JavaObject` argument costs one `IsInstanceOf`.
+@[direct_array_access]
+fn args_match(env &Env, desc string, classes []JavaClass, args []Type) bool {
+	mut i := 0
+	for k, arg in args {
+		start := i
+		for i < desc.len && desc[i] == `[` {
+			i++
+		}
+		if i < desc.len && desc[i] == `L` {
+			for i < desc.len && desc[i] != `;` {
+				i++
+			}
+		}
+		i++
+		if i > desc.len {
+			return false
+		}
+		if arg is JavaObject {
+			// Any instance of the class the method was resolved with fits the parameter
+			if classes.len == 0 || isnil(classes[k]) || !is_instance_of(env, arg, classes[k]) {
+				return false
+			}
+			continue
+		}
+		expected := v2j_signature_type(env, arg)
+		if expected.len != i - start || unsafe { vmemcmp(expected.str, &desc.str[start], expected.len) } != 0 {
+			return false
+		}
+	}
+	return i == desc.len
+}
+
+@[inline]
+fn (mut mc MethodCache) lookup_static(env &Env, key string, args []Type) ?MethodCacheEntry {
+	mc.mutex.@rlock()
+	entries := mc.statics[key] or { []MethodCacheEntry{} }
+	mc.mutex.runlock()
+	for entry in entries {
+		if args_match(env, entry.args, entry.arg_classes, args) {
+			mc.hit()
+			return entry
+		}
+	}
+	mc.miss()
+	return none
+}
+
+// static_method returns the cached static method for `signature` and the types of `args`,
+// resolving it on first use.
+fn (mut mc MethodCache) static_method(env &Env, signature string, args []Type) MethodCacheEntry {
+	if entry := mc.lookup_static(env, signature, args) {
+		return entry
+	}
+	fqn, return_type := parse_signature(signature)
+	jargs, classes := args_descriptor(env, args)
+	jdef := fqn + '(' + jargs + ')' + v2j_string_signature_type(return_type)
+	$if debug_signatures ? {
+		println(@MOD + '.' + @FN + ' Java call style definition: "${fqn} -> ${jdef}"')
+	}
+	return mc.resolve_static(env, signature, jargs, classes, jdef, return_type)
+}
+
+// static_method_desc returns the cached static method `name` with the Java descriptor `desc` on `class`,
+// resolving it on first use.
+fn (mut mc MethodCache) static_method_desc(env &Env, class string, name string, desc string) MethodCacheEntry {
+	mc.mutex.@rlock()
+	methods := mc.typed_statics[name] or { []TypedMethod{} }
+	mc.mutex.runlock()
+	for method in methods {
+		if method.desc == desc && method.class == class {
+			mc.hit()
+			return method.entry
+		}
+	}
+	mc.miss()
+
+	jdef := class + '.' + name + desc
+	jclass, mid := get_class_static_method_id(env, jdef)
+	if isnil(mid) {
+		// Not cached, the exception is pending for the caller
+		return MethodCacheEntry{}
+	}
+	method := TypedMethod{
+		class: class.clone()
+		desc:  desc.clone()
+		entry: MethodCacheEntry{
+			class: jclass // owned by the class registry
+			mid:   mid
+		}
+	}
+	mc.mutex.@lock()
+	defer {
+		mc.mutex.unlock()
+	}
+	current := mc.typed_statics[name] or { []TypedMethod{} }
+	for existing in current {
+		if existing.desc == desc && existing.class == class {
+			// Another thread resolved it first
+			return existing.entry
+		}
+	}
+	mut grown := []TypedMethod{cap: current.len + 1}
+	grown << current
+	grown << method
+	mc.typed_statics[name] = grown
+	return method.entry
+}
+
+fn (mut mc MethodCache) resolve_static(env &Env, key string, jargs string, classes []JavaClass, jdef string, return_type string) MethodCacheEntry {
+	class, mid := get_class_static_method_id(env, jdef)
+	if isnil(mid) {
+		// Not cached, the exception is pending for the caller
+		release_arg_classes(env, classes)
+		return MethodCacheEntry{
+			ret: value_kind(return_type)
+		}
+	}
+	entry := MethodCacheEntry{
+		class:       class // owned by the class registry
+		mid:         mid
+		ret:         value_kind(return_type)
+		args:        jargs
+		arg_classes: classes
+	}
+
+	mc.mutex.@lock()
+	defer {
+		mc.mutex.unlock()
+	}
+	entries := mc.statics[key] or { []MethodCacheEntry{} }
+	for existing in entries {
+		if existing.args == jargs {
+			// Another thread resolved it first
+			release_arg_classes(env, classes)
+			return existing
+		}
+	}
+	mut grown := []MethodCacheEntry{cap: entries.len + 1}
+	grown << entries
+	grown << entry
+	mc.statics[key] = grown
+	return entry
+}
+
+// object_method returns the cached method for `signature` and the types of `args` on the class of `obj`,
+// resolving it on first use. Up to `max_object_entries` receiver classes and argument descriptors
+// are remembered per signature, so polymorphic call sites stay cached.
+fn (mut mc MethodCache) object_method(env &Env, obj JavaObject, signature string, args []Type) MethodCacheEntry {
+	if entry := mc.lookup_object(env, obj, signature, args) {
+		return entry
+	}
+	fqn, return_type := parse_signature(signature)
+	jargs, classes := args_descriptor(env, args)
+	jdef := fqn + '(' + jargs + ')' + v2j_string_signature_type(return_type)
+	$if debug_signatures ? {
+		println(@MOD + '.' + @FN + ' Java call style definition: "${fqn} -> ${jdef}"')
+	}
+	return mc.resolve_object(env, obj, signature, jargs, classes, jdef, return_type)
+}
+
+// object_method_desc returns the cached method `name` with the Java descriptor `desc` on the class of `obj`,
+// resolving it on first use. Up to `max_object_entries` receiver classes and descriptors are remembered per name.
+fn (mut mc MethodCache) object_method_desc(env &Env, obj JavaObject, name string, desc string) MethodCacheEntry {
+	mc.mutex.@rlock()
+	methods := mc.typed_objects[name] or { []TypedMethod{} }
+	mc.mutex.runlock()
+	for method in methods {
+		if method.desc == desc && is_instance_of(env, obj, method.entry.class) {
+			mc.hit()
+			return method.entry
+		}
+	}
+	mc.miss()
+
+	jclass, mid := get_object_class_and_method_id(env, obj, name + desc)
+	if isnil(mid) {
+		// Not cached, the exception is pending for the caller
+		delete_local_ref(env, JavaObject(jclass))
+		return MethodCacheEntry{}
+	}
+	method := TypedMethod{
+		desc:  desc.clone()
+		entry: MethodCacheEntry{
+			class: JavaClass(new_global_ref(env, JavaObject(jclass)))
+			mid:   mid
+		}
+	}
+	delete_local_ref(env, JavaObject(jclass))
+
+	mc.mutex.@lock()
+	current := mc.typed_objects[name] or { []TypedMethod{} }
+	if current.len >= max_object_entries {
+		mc.mutex.unlock()
+		// A megamorphic call site, see `resolve_object`
+		delete_global_ref(env, JavaObject(method.entry.class))
+		return MethodCacheEntry{
+			mid: mid
+		}
+	}
+	mut grown := []TypedMethod{cap: current.len + 1}
+	grown << current
+	grown << method
+	mc.typed_objects[name] = grown
+	mc.mutex.unlock()
+	return method.entry
+}
+
+@[inline]
+fn (mut mc MethodCache) lookup_object(env &Env, obj JavaObject, key string, args []Type) ?MethodCacheEntry {
+	mc.mutex.@rlock()
+	entries := mc.objects[key] or { []MethodCacheEntry{} }
+	mc.mutex.runlock()
+	for entry in entries {
+		if is_instance_of(env, obj, entry.class)
+			&& args_match(env, entry.args, entry.arg_classes, args) {
+			mc.hit()
+			return entry
+		}
+	}
+	mc.miss()
+	return none
+}
+
+fn (mut mc MethodCache) resolve_object(env &Env, obj JavaObject, key string, jargs string, classes []JavaClass, jdef string, return_type string) MethodCacheEntry {
+	class, mid := get_object_class_and_method_id(env, obj, jdef)
+	if isnil(mid) {
+		// Not cached, the exception is pending for the caller
+		delete_local_ref(env, JavaObject(class))
+		release_arg_classes(env, classes)
+		return MethodCacheEntry{
+			ret: value_kind(return_type)
+		}
+	}
+	entry := MethodCacheEntry{
+		class:       JavaClass(new_global_ref(env, JavaObject(class)))
+		mid:         mid
+		ret:         value_kind(return_type)
+		args:        jargs
+		arg_classes: classes
+	}
+	delete_local_ref(env, JavaObject(class))
+
+	mc.mutex.@lock()
+	entries := mc.objects[key] or { []MethodCacheEntry{} }
+	if entries.len >= max_object_entries {
+		mc.mutex.unlock()
+		// A megamorphic call site, it is resolved on every call. Entries are never evicted
+		// since other threads may be checking them.
+		delete_global_ref(env, JavaObject(entry.class))
+		release_arg_classes(env, classes)
+		return MethodCacheEntry{
+			mid:  mid
+			ret:  entry.ret
+			args: jargs
+		}
+	}
+	mut grown := []MethodCacheEntry{cap: entries.len + 1}
+	grown << entries
+	grown << entry
+	mc.objects[key] = grown
+	mc.mutex.unlock()
+	return entry
+}
+
+// ClassDescriptor is a Java class (global ref) and its type descriptor, e.g. `Lio/vlang/V;`.
+struct ClassDescriptor {
+	class      JavaClass
+	descriptor string
+}
+
+// ClassDescriptorIDs are the method IDs used to look up class descriptors.
+struct ClassDescriptorIDs {
+	system        JavaClass    // java.lang.System, a class registry global ref
+	identity_hash JavaMethodID // System.identityHashCode(Object)
+	get_name      JavaMethodID // Class.getName()
+}
+
+// ClassDescriptorCache maps Java classes, by identity, to their type descriptors.
+// Classes are bucketed by their identity hash, so a lookup is one `identityHashCode`
+// call and, as a rule, one `IsSameObject` whatever the number of cached classes.
+// Buckets are replaced, never changed in place, and checked without holding the lock.
+struct ClassDescriptorCache {
+mut:
+	mutex    &sync.RwMutex = sync.new_rwmutex()
+	buckets  map[int][]ClassDescriptor
+	resolved bool
+	ids      ClassDescriptorIDs
+}
+
+fn class_descriptor_cache() &ClassDescriptorCache {
+	mut cdc := unsafe { &ClassDescriptorCache(state(.class_descriptors)) }
+	if isnil(cdc) {
+		cdc = unsafe { &ClassDescriptorCache(set_state_once(.class_descriptors, &ClassDescriptorCache{})) }
+	}
+	return cdc
+}
+
+// class_ids returns the method IDs of the cache, resolving them on first use.
+fn (mut cdc ClassDescriptorCache) class_ids(env &Env) ClassDescriptorIDs {
+	cdc.mutex.@rlock()
+	if cdc.resolved {
+		ids := cdc.ids
+		cdc.mutex.runlock()
+		return ids
+	}
+	cdc.mutex.runlock()
+
+	system := class_ref(env, 'java/lang/System')
+	class := class_ref(env, 'java/lang/Class')
+	ids := ClassDescriptorIDs{
+		system:        system
+		identity_hash: get_static_method_id(env, system, 'identityHashCode', '(Ljava/lang/Object;)I')
+		get_name:      get_method_id(env, class, 'getName', '()Ljava/lang/String;')
+	}
+	cdc.mutex.@lock()
+	cdc.ids = ids
+	cdc.resolved = true
+	cdc.mutex.unlock()
+	return ids
+}
+
+// class_descriptor returns the type descriptor of the class `cls`, e.g. `Lio/vlang/V;` or `[I`.
+// After the first lookup of a class this costs one `identityHashCode` call and no other Java calls.
+pub fn class_descriptor(env &Env, cls JavaClass) string {
+	mut cdc := class_descriptor_cache()
+	ids := cdc.class_ids(env)
+	args := [jvalue(env, JavaObject(cls))]!
+	hash := call_static_int_method_a(env, ids.system, ids.identity_hash, &args[0])
+
+	cdc.mutex.@rlock()
+	bucket := cdc.buckets[hash] or { []ClassDescriptor{} }
+	cdc.mutex.runlock()
+	for entry in bucket {
+		if is_same_object(env, JavaObject(entry.class), JavaObject(cls)) {
+			return entry.descriptor
+		}
+	}
+
+	name := call_string_method_a(env, JavaObject(cls), ids.get_name, void_arg.data)
+	descriptor := if name.starts_with('[') {
+		// Array classes are already named by their descriptor
+		name.replace('.', '/')
+	} else {
+		'L' + name.replace('.', '/') + ';'
+	}
+
+	cdc.mutex.@lock()
+	defer {
+		cdc.mutex.unlock()
+	}
+	current := cdc.buckets[hash] or { []ClassDescriptor{} }
+	for entry in current {
+		if entry.descriptor == descriptor {
+			// Another thread added it first, or a same named class from another class loader
+			// that happens to share the identity hash; that one is looked up every time
+			return descriptor
+		}
+	}
+	mut grown := []ClassDescriptor{cap: current.len + 1}
+	grown << current
+	grown << ClassDescriptor{
+		class:      JavaClass(new_global_ref(env, JavaObject(cls)))
+		descriptor: descriptor
+	}
+	cdc.buckets[hash] = grown
+	return descriptor
+}
+
+// object_descriptor returns the type descriptor of the class of `obj`, e.g. `Lio/vlang/V;`.
+// See `class_descriptor`.
+pub fn object_descriptor(env &Env, obj JavaObject) string {
+	cls := get_object_class(env, obj)
+	descriptor := class_descriptor(env, cls)
+	delete_local_ref(env, JavaObject(cls))
+	return descriptor
+}
+
+// clear_class_descriptor_cache deletes all global class references held by the descriptor cache.
+pub fn clear_class_descriptor_cache(env &Env) {
+	mut cdc := class_descriptor_cache()
+	cdc.mutex.@lock()
+	for _, bucket in cdc.buckets {
+		for entry in bucket {
+			delete_global_ref(env, JavaObject(entry.class))
+		}
+	}
+	cdc.buckets.clear()
+	cdc.resolved = false
+	cdc.ids = ClassDescriptorIDs{}
+	cdc.mutex.unlock()
+}
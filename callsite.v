@@ -0,0 +1,430 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+// CallSite is a prepared Java method call.
+// The signature is parsed and the class and method ID are resolved once
+// when the call site is prepared. Calling it only fills the argument
+// values and dispatches directly to the matching `call_*_method_a` function.
+//
+// Example:
+// ```v
+// mut cs := jni.prepare_static_method(env, 'io.vlang.V.mixedArguments(bool, int) int')
+// for i in 0 .. 1000 {
+//	cs.set_bool(0, true)
+//	cs.set_int(1, i)
+//	r := cs.call_int(env)
+// }
+// cs.free(env)
+// ```
+pub struct CallSite {
+pub:
+	signature string
+	is_static bool
+	ret       ValueKind
+	arg_kinds []ValueKind
+mut:
+	class  JavaClass // global ref, owned by the class registry for static methods
+	mid    JavaMethodID
+	target JavaObject
+	args   []JavaValue
+	owned  []bool // args holding a Java string made by `set_string`
+}
+
+// v2j_descriptor returns the Java method descriptor, e.g. `(ZI)I`, of a `jni` style signature.
+// The argument types are taken from the signature text, so object arguments must be given
+// as fully qualified class names, e.g. `passInstance(io.vlang.V)`.
+pub fn v2j_descriptor(signature string) (string, []ValueKind, ValueKind) {
+	_, return_type := parse_signature(signature)
+	args_str := signature.all_after('(').all_before_last(')').trim_space()
+	mut kinds := []ValueKind{}
+	mut jargs := ''
+	if args_str != '' {
+		for arg in args_str.split(',') {
+			v_type := arg.trim_space()
+			kinds << value_kind(v_type)
+			jargs += v2j_string_signature_type(v_type)
+		}
+	}
+	return '(' + jargs + ')' + v2j_string_signature_type(return_type), kinds, value_kind(return_type)
+}
+
+// prepare_static_method resolves the static method described by `signature` for repeated calls.
+pub fn prepare_static_method(env &Env, signature string) CallSite {
+	fqn, _ := parse_signature(signature)
+	desc, arg_kinds, ret := v2j_descriptor(signature)
+	class, mid := get_class_static_method_id(env, fqn + desc)
+	check_method(env, mid, signature)
+	cs := CallSite{
+		signature: signature
+		is_static: true
+		ret:       ret
+		arg_kinds: arg_kinds
+		class:     class
+		mid:       mid
+		args:      []JavaValue{len: arg_kinds.len}
+		owned:     []bool{len: arg_kinds.len}
+	}
+	return cs
+}
+
+// prepare_object_method resolves the method described by `signature` on the class of `obj` for repeated calls.
+// The call site is bound to `obj`, use `bind` to call the method on another instance of the same class.
+pub fn prepare_object_method(env &Env, obj JavaObject, signature string) CallSite {
+	fqn, _ := parse_signature(signature)
+	desc, arg_kinds, ret := v2j_descriptor(signature)
+	class, mid := get_object_class_and_method_id(env, obj, fqn + desc)
+	check_method(env, mid, signature)
+	cs := CallSite{
+		signature: signature
+		is_static: false
+		ret:       ret
+		arg_kinds: arg_kinds
+		class:     JavaClass(new_global_ref(env, JavaObject(class)))
+		mid:       mid
+		target:    obj
+		args:      []JavaValue{len: arg_kinds.len}
+		owned:     []bool{len: arg_kinds.len}
+	}
+	delete_local_ref(env, JavaObject(class))
+	return cs
+}
+
+// free releases the global class reference and the argument strings held by the call site.
+pub fn (mut cs CallSite) free(env &Env) {
+	cs.release_strings(env)
+	if !cs.is_static && !isnil(cs.class) {
+		delete_global_ref(env, JavaObject(cs.class))
+		cs.class = JavaClass(unsafe { nil })
+	}
+}
+
+// release_strings deletes the Java strings made by `set_string`.
+fn (mut cs CallSite) release_strings(env &Env) {
+	for i, owned in cs.owned {
+		if owned {
+			delete_local_ref(env, cs.args[i].l)
+			cs.owned[i] = false
+		}
+	}
+}
+
+// forget_strings forgets the Java strings made by `set_string`, after the local frame
+// they were made in has been popped.
+@[inline]
+fn (mut cs CallSite) forget_strings() {
+	for i in 0 .. cs.owned.len {
+		cs.owned[i] = false
+	}
+}
+
+// bind sets the object instance the (non-static) method is called on.
+@[inline]
+pub fn (mut cs CallSite) bind(obj JavaObject) {
+	cs.target = obj
+}
+
+fn (cs &CallSite) check_arg(index int, kind ValueKind) {
+	if index < 0 || index >= cs.arg_kinds.len {
+		panic(@MOD + '.' + @FN + ': argument index ${index} out of range for "${cs.signature}"')
+	}
+	if cs.arg_kinds[index] != kind {
+		panic(@MOD + '.' + @FN +
+			': argument ${index} of "${cs.signature}" is ${cs.arg_kinds[index]} not ${kind}')
+	}
+}
+
+fn (cs &CallSite) check_return(kind ValueKind) {
+	if cs.ret != kind {
+		panic(@MOD + '.' + @FN + ': "${cs.signature}" returns ${cs.ret} not ${kind}')
+	}
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_bool(index int, val bool) {
+	$if debug {
+		cs.check_arg(index, .bool)
+	}
+	cs.args[index] = JavaValue{
+		z: jboolean(val)
+	}
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_u8(index int, val u8) {
+	$if debug {
+		cs.check_arg(index, .u8)
+	}
+	cs.args[index] = JavaValue{
+		b: jbyte(val)
+	}
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_rune(index int, val rune) {
+	$if debug {
+		cs.check_arg(index, .rune)
+	}
+	cs.args[index] = JavaValue{
+		c: jchar(val)
+	}
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_i16(index int, val i16) {
+	$if debug {
+		cs.check_arg(index, .i16)
+	}
+	cs.args[index] = JavaValue{
+		s: jshort(val)
+	}
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_int(index int, val int) {
+	$if debug {
+		cs.check_arg(index, .int)
+	}
+	cs.args[index] = JavaValue{
+		i: jint(val)
+	}
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_i64(index int, val i64) {
+	$if debug {
+		cs.check_arg(index, .i64)
+	}
+	cs.args[index] = JavaValue{
+		j: jlong(val)
+	}
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_f32(index int, val f32) {
+	$if debug {
+		cs.check_arg(index, .f32)
+	}
+	cs.args[index] = JavaValue{
+		f: jfloat(val)
+	}
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_f64(index int, val f64) {
+	$if debug {
+		cs.check_arg(index, .f64)
+	}
+	cs.args[index] = JavaValue{
+		d: jdouble(val)
+	}
+}
+
+// set_string converts `val` to a Java string (a new local reference) and sets it as argument `index`.
+// The string set before in `index`, if any, is deleted.
+@[inline]
+pub fn (mut cs CallSite) set_string(env &Env, index int, val string) {
+	$if debug {
+		cs.check_arg(index, .string)
+	}
+	if cs.owned[index] {
+		delete_local_ref(env, cs.args[index].l)
+	}
+	cs.args[index] = JavaValue{
+		l: JavaObject(jstring(env, val))
+	}
+	cs.owned[index] = true
+}
+
+@[inline]
+pub fn (mut cs CallSite) set_object(index int, val JavaObject) {
+	$if debug {
+		if cs.arg_kinds[index] != .string {
+			cs.check_arg(index, .object)
+		}
+	}
+	// A string made by `set_string` is left to the local frame it was made in
+	cs.owned[index] = false
+	cs.args[index] = JavaValue{
+		l: val
+	}
+}
+
+@[inline]
+pub fn (cs &CallSite) call_void(env &Env) {
+	$if debug {
+		cs.check_return(.void)
+	}
+	start := stats_now()
+	if cs.is_static {
+		call_static_void_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_void_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+}
+
+@[inline]
+pub fn (cs &CallSite) call_bool(env &Env) bool {
+	$if debug {
+		cs.check_return(.bool)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_boolean_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_boolean_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_u8(env &Env) u8 {
+	$if debug {
+		cs.check_return(.u8)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_byte_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_byte_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_rune(env &Env) rune {
+	$if debug {
+		cs.check_return(.rune)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_char_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_char_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_i16(env &Env) i16 {
+	$if debug {
+		cs.check_return(.i16)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_short_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_short_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_int(env &Env) int {
+	$if debug {
+		cs.check_return(.int)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_int_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_int_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_i64(env &Env) i64 {
+	$if debug {
+		cs.check_return(.i64)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_long_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_long_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_f32(env &Env) f32 {
+	$if debug {
+		cs.check_return(.f32)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_float_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_float_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_f64(env &Env) f64 {
+	$if debug {
+		cs.check_return(.f64)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_double_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_double_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_string(env &Env) string {
+	$if debug {
+		cs.check_return(.string)
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_string_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_string_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+@[inline]
+pub fn (cs &CallSite) call_object(env &Env) JavaObject {
+	$if debug {
+		if cs.ret != .string {
+			cs.check_return(.object)
+		}
+	}
+	start := stats_now()
+	r := if cs.is_static {
+		call_static_object_method_a(env, cs.class, cs.mid, cs.args.data)
+	} else {
+		call_object_method_a(env, cs.target, cs.mid, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return r
+}
+
+// invoke calls the prepared method and wraps the result in a `CallResult`.
+// The typed `call_*` methods should be preferred in hot code paths.
+pub fn (cs &CallSite) invoke(env &Env) CallResult {
+	start := stats_now()
+	result := if cs.is_static {
+		static_result(env, cs.class, cs.mid, cs.ret, cs.args.data)
+	} else {
+		object_result(env, cs.target, cs.mid, cs.ret, cs.args.data)
+	}
+	stats_call(cs.signature, start)
+	return call_result(cs.signature, result)
+}
@@ -0,0 +1,42 @@
+module jni
+
+fn test_parse_signature() {
+	fqn, ret := parse_signature('io.vlang.V.getInt() int')
+	assert fqn == 'io.vlang.V.getInt'
+	assert ret == 'int'
+	fqn2, ret2 := parse_signature('  io.vlang.V.run()  ')
+	assert fqn2 == 'io.vlang.V.run'
+	assert ret2 == 'void'
+	_, ret3 := parse_signature('toString() string')
+	assert ret3 == 'string'
+}
+
+fn test_v2j_descriptor_primitives() {
+	desc, kinds, ret := v2j_descriptor('io.vlang.V.vAddInt(int, int) int')
+	assert desc == '(II)I'
+	assert kinds == [ValueKind.int, .int]
+	assert ret == .int
+
+	desc2, kinds2, ret2 := v2j_descriptor('mixed(bool, u8, rune, i16, i64, f32, f64)')
+	assert desc2 == '(ZBCSJFD)V'
+	assert kinds2 == [ValueKind.bool, .u8, .rune, .i16, .i64, .f32, .f64]
+	assert ret2 == .void
+
+	desc3, kinds3, _ := v2j_descriptor('io.vlang.V.run() void')
+	assert desc3 == '()V'
+	assert kinds3.len == 0
+}
+
+fn test_v2j_descriptor_objects() {
+	desc, kinds, ret := v2j_descriptor('passInstance(io.vlang.V, string, object) io/vlang/V')
+	assert desc == '(Lio/vlang/V;Ljava/lang/String;Ljava/lang/Object;)Lio/vlang/V;'
+	assert kinds == [ValueKind.object, .string, .object]
+	assert ret == .object
+}
+
+fn test_v2j_descriptor_arrays() {
+	desc, kinds, ret := v2j_descriptor('sum([I, [Ljava.lang.String;) [J')
+	assert desc == '([I[Ljava/lang/String;)[J'
+	assert kinds == [ValueKind.object, .object]
+	assert ret == .object
+}
@@ -0,0 +1,73 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+// Class registry.
+//
+// `class_ref` resolves a class name once, via `find_class`, and keeps the class as a
+// global reference in a process-wide registry (see `gClassGet`/`gClassPut` in c/helpers.h).
+// Later lookups, from any thread, are a lock-free hash table probe: no `FindClass`,
+// no `ClassLoader.findClass` round trip on Android and no name conversion.
+//
+// Example:
+// ```v
+// @[export: 'JNI_OnLoad']
+// fn jni_on_load(vm &jni.JavaVM, reserved voidptr) int {
+//	jni.set_java_vm(vm)
+//	jni.preload_classes(jni.default_env(), ['io.vlang.V', 'java.lang.String'])
+//	return int(jni.Version.v1_6)
+// }
+// ```
+
+// class_ref returns the class named `name` (e.g. 'io.vlang.V' or 'io/vlang/V', both forms
+// share one registry entry).
+// The returned class is a *global* reference owned by the registry, it must not be deleted
+// and can be used from any thread until `clear_class_registry` is called.
+// `nil` is returned, with a Java exception pending, if the class could not be found.
+pub fn class_ref(env &Env, name string) JavaClass {
+	cls := C.gClassGet(&char(name.str), name.len)
+	if !isnil(cls) {
+		stats_class_lookup(false)
+		return cls
+	}
+	if isnil(env) {
+		panic(@MOD + '.' + @FN + ': JNI environment pointer jni.Env(${ptr_str(env)})" is invalid')
+	}
+	local := find_class_unchecked(env, name.replace('.', '/'))
+	stats_class_lookup(!isnil(local))
+	if isnil(local) {
+		return local
+	}
+	global := JavaClass(new_global_ref(env, JavaObject(local)))
+	delete_local_ref(env, JavaObject(local))
+	registered := C.gClassPut(&char(name.str), name.len, global)
+	if registered != global {
+		// Another thread registered the class first
+		delete_global_ref(env, JavaObject(global))
+	}
+	return registered
+}
+
+// preload_classes registers the classes in `names`, e.g. from `JNI_OnLoad` or right after
+// `setup_android`, where the class loader of the application is guaranteed to be available.
+// It returns the number of classes that could be found.
+pub fn preload_classes(env &Env, names []string) int {
+	mut found := 0
+	for name in names {
+		if isnil(class_ref(env, name)) {
+			$if debug {
+				exception_describe(env)
+			}
+			exception_clear(env)
+			continue
+		}
+		found++
+	}
+	return found
+}
+
+// clear_class_registry deletes all registered classes. Classes previously returned
+// by `class_ref` are invalid afterwards. It is called by `on_unload`.
+pub fn clear_class_registry(env &Env) {
+	C.gClassClear(env)
+}
@@ -0,0 +1,120 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+// Critical (zero-copy) access to primitive arrays and strings.
+//
+// Between getting and releasing a critical region the JavaVM may have paused
+// the garbage collector, so the code in between must be short, must not block
+// and must not call *any* other JNI function (except nested critical access).
+// Builds with `-d debug` panic when a Java method is called through `jni` inside a critical
+// region, and when `T` does not match the element type of the Java array.
+//
+// Example:
+// ```v
+// jni.with_critical[u8](env, pixels, .commit_and_free, fn (mut data []u8) {
+//	for i in 0 .. data.len {
+//		data[i] = 255 - data[i]
+//	}
+// })
+// ```
+
+// CriticalArray is a primitive Java array pinned via `GetPrimitiveArrayCritical`.
+// `data` is a V array view of the Java array's memory.
+pub struct CriticalArray[T] {
+pub:
+	arr     JavaArray
+	is_copy bool
+pub mut:
+	data []T
+	mode ReleaseMode = .commit_and_free // the mode `release` will use
+mut:
+	released bool
+}
+
+// critical pins the Java array `arr` and returns a view of its elements.
+// The array must be released with `release` as soon as possible.
+pub fn critical[T](env &Env, arr JavaArray) CriticalArray[T] {
+	$if debug {
+		// Checked before pinning, the check calls Java
+		desc := object_descriptor(env, JavaObject(arr))
+		if desc != array_descriptor[T]() {
+			panic(@MOD + '.' + @FN + ': array ${ptr_str(arr)} is a ${desc}, not a ${array_descriptor[T]()}')
+		}
+	} $else {
+		array_descriptor[T]()
+	}
+	len := get_array_length(env, arr)
+	mut is_copy := jboolean(false)
+	ptr := C.GetPrimitiveArrayCritical(env, arr, &is_copy)
+	if isnil(ptr) {
+		panic(@MOD + '.' + @FN + ': could not get critical access to array ${ptr_str(arr)} in jni.Env (${ptr_str(env)})')
+	}
+	$if debug {
+		C.gCriticalEnter()
+	}
+	return CriticalArray[T]{
+		arr:     arr
+		is_copy: j2v_boolean(is_copy)
+		data:    unsafe { array_view[T](ptr, len) }
+	}
+}
+
+// release releases the array with the recorded `mode`.
+// `.commit` is not supported for critical regions and is treated as `.commit_and_free`.
+pub fn (mut ca CriticalArray[T]) release(env &Env) {
+	if ca.released {
+		return
+	}
+	ca.released = true
+	mode := if ca.mode == .abort { ReleaseMode.abort } else { ReleaseMode.commit_and_free }
+	C.ReleasePrimitiveArrayCritical(env, ca.arr, ca.data.data, jint(int(mode)))
+	$if debug {
+		C.gCriticalExit()
+	}
+	ca.data = []T{}
+}
+
+// with_critical pins the Java array `arr`, calls `f` with a view of its elements
+// and releases the array with `mode` when `f` returns.
+// Use `.abort` when `f` only reads the elements to spare the JavaVM a write back, if it made a copy.
+pub fn with_critical[T](env &Env, arr JavaArray, mode ReleaseMode, f fn (mut data []T)) {
+	mut ca := critical[T](env, arr)
+	ca.mode = mode
+	defer {
+		ca.release(env)
+	}
+	f(mut ca.data)
+}
+
+// with_string_critical calls `f` with a view of the UTF-16 code units of `jstr`.
+// The code units must not be modified.
+pub fn with_string_critical(env &Env, jstr JavaString, f fn (chars []u16)) {
+	len := get_string_length(env, jstr)
+	chars, _ := get_string_critical(env, jstr)
+	if isnil(chars) {
+		panic(@MOD + '.' + @FN + ': could not get critical access to string ${ptr_str(jstr)} in jni.Env (${ptr_str(env)})')
+	}
+	defer {
+		release_string_critical(env, jstr, chars)
+	}
+	f(unsafe { array_view[u16](chars, len) })
+}
+
+// in_critical returns `true` if the calling thread is inside a critical region.
+// It is only tracked in `-d debug` builds and always `false` otherwise.
+@[inline]
+pub fn in_critical() bool {
+	$if debug {
+		return C.gCriticalRegionsHeld() > 0
+	}
+	return false
+}
+
+// check_not_critical panics if the calling thread is inside a critical region.
+@[inline]
+fn check_not_critical(caller string) {
+	if in_critical() {
+		panic(@MOD + '.' + caller + ': JNI call made inside a critical region')
+	}
+}
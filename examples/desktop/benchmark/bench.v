@@ -0,0 +1,285 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+//
+// JNI crossing microbenchmarks.
+//
+// Runs an embedded JavaVM (see `jni.host`) and measures the overhead of the different
+// ways of calling into Java. Every benchmark is run `batches` times, `batch` operations
+// per batch; one JSON object per benchmark is written to stdout, a summary to stderr.
+//
+// export JAVA_HOME="/path/to/jdk/root"
+// javac io/vlang/bench/Harness.java && v -prod run bench.v > results.jsonl
+//
+module main
+
+import flag
+import json
+import os
+import time
+import jni
+import jni.host
+
+const harness = 'io.vlang.bench.Harness'
+
+type BenchFn = fn (env &jni.Env, n int)
+
+struct Bench {
+	name string
+	f    BenchFn
+}
+
+// Site keeps a prepared call site on the heap, so the benchmark closure can reuse its argument buffer.
+@[heap]
+struct Site {
+mut:
+	cs jni.CallSite
+}
+
+// Result is one line of the machine readable output. Times are nanoseconds per operation.
+struct Result {
+	name         string
+	ops          i64
+	ns_per_op    f64
+	min_ns       f64
+	p50_ns       f64
+	p90_ns       f64
+	p99_ns       f64
+	max_ns       f64
+	bytes_per_op f64 // bytes allocated on the V heap (GC) per operation
+}
+
+struct Startup {
+	name           string = 'jvm_startup'
+	create_vm_ns   i64
+	first_class_ns i64
+}
+
+struct Config {
+	batches int
+	batch   int
+}
+
+fn percentile(sorted []f64, p f64) f64 {
+	if sorted.len == 0 {
+		return 0
+	}
+	index := int(p * f64(sorted.len - 1) + 0.5)
+	return sorted[index]
+}
+
+fn measure(env &jni.Env, cfg Config, b Bench) Result {
+	// Warm up, also resolves and caches everything the benchmark looks up
+	b.f(env, cfg.batch)
+
+	mut samples := []f64{cap: cfg.batches}
+	mut total := u64(0)
+	bytes_before := gc_heap_usage().total_bytes
+	for _ in 0 .. cfg.batches {
+		start := time.sys_mono_now()
+		b.f(env, cfg.batch)
+		elapsed := time.sys_mono_now() - start
+		total += elapsed
+		samples << f64(elapsed) / f64(cfg.batch)
+	}
+	bytes_after := gc_heap_usage().total_bytes
+	samples.sort()
+	ops := i64(cfg.batches) * cfg.batch
+	return Result{
+		name:         b.name
+		ops:          ops
+		ns_per_op:    f64(total) / f64(ops)
+		min_ns:       samples[0]
+		p50_ns:       percentile(samples, 0.50)
+		p90_ns:       percentile(samples, 0.90)
+		p99_ns:       percentile(samples, 0.99)
+		max_ns:       samples[samples.len - 1]
+		bytes_per_op: f64(bytes_after - bytes_before) / f64(ops)
+	}
+}
+
+fn benchmarks(env &jni.Env, cls jni.JavaClass) []Bench {
+	add_sig := harness + '.add(int, int) int'
+	mid_add := jni.get_static_method_id(env, cls, 'add', '(II)I')
+	mid_init := jni.get_method_id(env, cls, '<init>', '()V')
+	obj := jni.new_global_ref(env, jni.new_object_a(env, cls, mid_init, jni.void_arg.data))
+	site := &Site{
+		cs: jni.prepare_static_method(env, add_sig)
+	}
+	text := 'The quick brown fox jumps over the lazy dog'
+	data := []int{len: 1024, init: index}
+	filled := jni.new_global_ref(env, jni.JavaObject(jni.array_from_v[int](env, data)))
+
+	return [
+		Bench{
+			name: 'call_static_method'
+			f:    fn [add_sig] (env &jni.Env, n int) {
+				for i in 0 .. n {
+					_ = jni.call_static_method(env, add_sig, i, 1)
+				}
+			}
+		},
+		Bench{
+			name: 'call_static_method_int'
+			f:    fn [add_sig] (env &jni.Env, n int) {
+				for i in 0 .. n {
+					_ = jni.call_static_method_int(env, add_sig, i, 1)
+				}
+			}
+		},
+		Bench{
+			name: 'object_call'
+			f:    fn [obj] (env &jni.Env, n int) {
+				o := jni.object(env, obj)
+				for _ in 0 .. n {
+					_ = o.call(.object, 'inc() int')
+				}
+			}
+		},
+		Bench{
+			name: 'call_static_int_method_a'
+			f:    fn [cls, mid_add] (env &jni.Env, n int) {
+				mut args := [2]jni.JavaValue{}
+				for i in 0 .. n {
+					args[0] = jni.jvalue(env, i)
+					args[1] = jni.jvalue(env, 1)
+					_ = jni.call_static_int_method_a(env, cls, mid_add, &args[0])
+				}
+			}
+		},
+		Bench{
+			name: 'callsite_call_int'
+			f:    fn [site] (env &jni.Env, n int) {
+				mut s := unsafe { site }
+				for i in 0 .. n {
+					s.cs.set_int(0, i)
+					s.cs.set_int(1, 1)
+					_ = s.cs.call_int(env)
+				}
+			}
+		},
+		Bench{
+			name: 'string_roundtrip'
+			f:    fn [text] (env &jni.Env, n int) {
+				for _ in 0 .. n {
+					jstr := jni.jstring(env, text)
+					_ = jni.j2v_string(env, jstr)
+					jni.delete_local_ref(env, jni.JavaObject(jstr))
+				}
+			}
+		},
+		Bench{
+			name: 'string_echo'
+			f:    fn [text] (env &jni.Env, n int) {
+				for _ in 0 .. n {
+					_ = jni.call_static_method_string(env, harness + '.echo(string) string', text)
+				}
+			}
+		},
+		Bench{
+			name: 'array_from_v_1k'
+			f:    fn [data] (env &jni.Env, n int) {
+				for _ in 0 .. n {
+					arr := jni.array_from_v[int](env, data)
+					jni.delete_local_ref(env, jni.JavaObject(arr))
+				}
+			}
+		},
+		Bench{
+			name: 'array_to_v_1k'
+			f:    fn [filled] (env &jni.Env, n int) {
+				for _ in 0 .. n {
+					_ = jni.array_to_v[int](env, jni.JavaArray(filled))
+				}
+			}
+		},
+		Bench{
+			name: 'class_name'
+			f:    fn [obj] (env &jni.Env, n int) {
+				// `class_name` leaves its local references to the caller
+				mut frame := jni.local_frame(env, 4 * n)
+				for _ in 0 .. n {
+					_ = obj.class_name(env)
+				}
+				frame.pop(jni.JavaObject(unsafe { nil }))
+			}
+		},
+		Bench{
+			name: 'attach_detach'
+			f:    fn (env &jni.Env, n int) {
+				// A fresh thread per batch, each operation is one attach plus one detach
+				t := spawn fn (n int) {
+					for _ in 0 .. n {
+						jni.attach_current_thread('V bench')
+						jni.detach_current_thread()
+					}
+				}(n)
+				t.wait()
+			}
+		},
+		Bench{
+			name: 'local_refs_frame'
+			f:    fn [obj] (env &jni.Env, n int) {
+				mut frame := jni.local_frame(env, n)
+				for _ in 0 .. n {
+					jni.new_local_ref(env, obj)
+				}
+				frame.pop(jni.JavaObject(unsafe { nil }))
+			}
+		},
+		Bench{
+			name: 'local_refs_delete'
+			f:    fn [obj] (env &jni.Env, n int) {
+				for _ in 0 .. n {
+					ref := jni.new_local_ref(env, obj)
+					jni.delete_local_ref(env, ref)
+				}
+			}
+		},
+	]
+}
+
+fn main() {
+	mut fp := flag.new_flag_parser(os.args)
+	fp.application('bench')
+	fp.description('JNI crossing microbenchmarks, writes JSON lines to stdout')
+	batches := fp.int('batches', `b`, 200, 'number of timed batches per benchmark')
+	batch := fp.int('batch', `n`, 1000, 'operations per batch')
+	filter := fp.string('filter', `f`, '', 'only run benchmarks with names containing this')
+	classpath := fp.string('classpath', `c`, os.dir(@FILE), 'where to find io/vlang/bench/Harness.class')
+	fp.finalize() or {
+		eprintln(err)
+		println(fp.usage())
+		exit(1)
+	}
+
+	mut vm := host.create(classpath: [classpath]) or {
+		eprintln(err)
+		exit(1)
+	}
+	cls := vm.load_class(harness) or {
+		eprintln(err)
+		exit(1)
+	}
+	println(json.encode(Startup{
+		create_vm_ns:   vm.timings.create_vm.nanoseconds()
+		first_class_ns: vm.timings.first_class.nanoseconds()
+	}))
+	eprintln(vm.report())
+
+	env := vm.env
+	jni.call_static_method_void(env, harness + '.warmup(int)', 10_000)
+	cfg := Config{
+		batches: batches
+		batch:   batch
+	}
+	eprintln('benchmark                       ns/op        p50        p99     B/op')
+	for b in benchmarks(env, cls) {
+		if filter != '' && !b.name.contains(filter) {
+			continue
+		}
+		r := measure(env, cfg, b)
+		println(json.encode(r))
+		eprintln('${r.name:-26} ${r.ns_per_op:10.1f} ${r.p50_ns:10.1f} ${r.p99_ns:10.1f} ${r.bytes_per_op:8.1f}')
+	}
+	vm.destroy() or { eprintln(err) }
+}
@@ -0,0 +1,53 @@
+package io.vlang.bench;
+
+// Harness holds the Java side of the JNI crossing benchmarks in bench.v.
+// The methods do as little as possible so the numbers are dominated by the crossing itself.
+public class Harness
+{
+	private int m_counter;
+
+	public static int getInt() {
+		return 42;
+	}
+
+	public static int add(int a, int b) {
+		return a + b;
+	}
+
+	public static String echo(String s) {
+		return s;
+	}
+
+	public static int sum(int[] values) {
+		int sum = 0;
+		for (int v : values) {
+			sum += v;
+		}
+		return sum;
+	}
+
+	public static int[] fill(int n) {
+		int[] values = new int[n];
+		for (int i = 0; i < n; i++) {
+			values[i] = i;
+		}
+		return values;
+	}
+
+	public int inc() {
+		return ++m_counter;
+	}
+
+	// Runs the targets once per method so the JIT has seen every call before V starts measuring.
+	public static void warmup(int rounds) {
+		Harness h = new Harness();
+		int[] values = fill(64);
+		for (int i = 0; i < rounds; i++) {
+			getInt();
+			add(i, 1);
+			echo("warmup");
+			sum(values);
+			h.inc();
+		}
+	}
+}
@@ -0,0 +1,62 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module bindgen
+
+// Name and descriptor helpers of bindgen.vsh, in a module of their own so they can be tested.
+
+const v_keywords = ['as', 'asm', 'assert', 'atomic', 'break', 'const', 'continue', 'defer', 'else',
+	'enum', 'false', 'fn', 'for', 'go', 'goto', 'if', 'import', 'in', 'interface', 'is', 'isreftype',
+	'lock', 'match', 'module', 'mut', 'none', 'or', 'pub', 'return', 'rlock', 'select', 'shared',
+	'sizeof', 'spawn', 'static', 'struct', 'true', 'type', 'typeof', 'union', 'unsafe', 'volatile',
+	'__global', '__offsetof', 'nil', 'env', 'obj', 'args']
+
+// split_descriptor returns the parameter and return type descriptors of a method descriptor.
+pub fn split_descriptor(desc string) ([]string, string) {
+	mut params := []string{}
+	mut i := 1
+	for desc[i] != `)` {
+		start := i
+		for desc[i] == `[` {
+			i++
+		}
+		if desc[i] == `L` {
+			i = desc.index_after(';', i) or { desc.len - 1 }
+		}
+		i++
+		params << desc[start..i]
+	}
+	return params, desc[i + 1..]
+}
+
+// snake_case returns the V name of the Java name `name`, e.g. `mixed_arguments` for `mixedArguments`.
+// V keywords and names used by the generated code get a trailing `_`.
+pub fn snake_case(name string) string {
+	mut sb := []u8{}
+	for i, c in name {
+		if c.is_capital() {
+			if i > 0 && (!name[i - 1].is_capital() || (i + 1 < name.len && !name[i + 1].is_capital())) {
+				sb << `_`
+			}
+			sb << c + 32
+		} else if c == `$` {
+			sb << `_`
+		} else {
+			sb << c
+		}
+	}
+	s := sb.bytestr()
+	return if s in v_keywords { s + '_' } else { s }
+}
+
+// unique_name returns `name`, with a numbered suffix for overloads.
+pub fn unique_name(mut used map[string]int, name string) string {
+	n := used[name]
+	used[name] = n + 1
+	return if n == 0 { name } else { '${name}_${n}' }
+}
+
+// module_name returns the name of the V module generated for the class `class_name`,
+// e.g. `io_vlang_v` for `io/vlang/V`.
+pub fn module_name(class_name string) string {
+	return class_name.split('/').map(snake_case(it).trim_right('_')).join('_')
+}
@@ -0,0 +1,38 @@
+module bindgen
+
+fn test_split_descriptor() {
+	params, ret := split_descriptor('(ZI)V')
+	assert params == ['Z', 'I']
+	assert ret == 'V'
+
+	params2, ret2 := split_descriptor('(Ljava/lang/String;[I[[Lio/vlang/V;J)Ljava/lang/Object;')
+	assert params2 == ['Ljava/lang/String;', '[I', '[[Lio/vlang/V;', 'J']
+	assert ret2 == 'Ljava/lang/Object;'
+
+	params3, ret3 := split_descriptor('()[B')
+	assert params3.len == 0
+	assert ret3 == '[B'
+}
+
+fn test_snake_case() {
+	assert snake_case('mixedArguments') == 'mixed_arguments'
+	assert snake_case('getURL') == 'get_url'
+	assert snake_case('URLDecoder') == 'url_decoder'
+	assert snake_case('x') == 'x'
+	// V keywords and names used by the generated functions
+	assert snake_case('type') == 'type_'
+	assert snake_case('env') == 'env_'
+}
+
+fn test_module_name() {
+	assert module_name('io/vlang/V') == 'io_vlang_v'
+	assert module_name('java/lang/Module') == 'java_lang_module'
+}
+
+fn test_unique_name() {
+	mut used := map[string]int{}
+	assert unique_name(mut used, 'foo') == 'foo'
+	assert unique_name(mut used, 'foo') == 'foo_1'
+	assert unique_name(mut used, 'bar') == 'bar'
+	assert unique_name(mut used, 'foo') == 'foo_2'
+}
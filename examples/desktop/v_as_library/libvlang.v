@@ -14,6 +14,11 @@ fn jni_on_load(vm &jni.JavaVM, reserved voidptr) int {
 	return int(jni.Version.v1_6)
 }
 
+@[export: 'JNI_OnUnload']
+fn jni_on_unload(vm &jni.JavaVM, reserved voidptr) {
+	jni.on_unload(vm)
+}
+
 @[export: 'JNICALL Java_io_vlang_V_callStaticMethods']
 fn call_static_methods(env &jni.Env, thiz jni.JavaObject) {
 	// Object call style
@@ -30,6 +35,16 @@ fn call_static_methods(env &jni.Env, thiz jni.JavaObject) {
 		2)
 	println('V: ${r3.result}')
 
+	// prepared call style
+	mut cs := jni.prepare_static_method(env, 'io.vlang.V.mixedArguments(bool, int) int')
+	cs.set_bool(0, true)
+	cs.set_int(1, 3)
+	println('V: ${cs.call_int(env)}')
+	cs.free(env)
+
+	// statically typed call style
+	println('V: ${jni.call_static2[int, bool, int](env, pkg, 'mixedArguments', true, 4)}')
+
 	jprintln('Hello from V - this shows up in Java')
 
 	jffr := java_float_func('Hello', 22)
@@ -59,6 +74,8 @@ fn call_object_methods(env &jni.Env, thiz jni.JavaObject) {
 	println('V: Passing io.vlang.V object type from V to Java...')
 	// call "public void passInstance(V v)" on "io.vlang.V" instance
 	jni.call_object_method(env, thiz, 'passInstance(io.vlang.V)', java_object)
+
+	println('V: ${jni.method_cache_stats()}')
 }
 
 @[export: 'JNICALL Java_io_vlang_V_vGetString']
@@ -0,0 +1,382 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import strings
+import sync
+
+// Result returning calls.
+//
+// The `try_*` variants of the call, class and member lookup functions never panic on Java exceptions.
+// They do one `ExceptionCheck` per call and return a pending exception as a `JavaException` error.
+// Taking an exception only keeps a global reference to it: its class name, message and
+// stack trace are read from Java when asked for, with the `Env` of the asking thread.
+//
+// Example:
+// ```v
+// n := jni.try_call_static_method_as[int](env, 'java.lang.Integer.parseInt(string) int', input) or {
+//	if err is jni.JavaException {
+//		defer {
+//			err.free(env)
+//		}
+//		if err.class_name(env) == 'java.lang.NumberFormatException' {
+//			return 0
+//		}
+//	}
+//	return err
+// }
+// ```
+//
+// Specific Java exception classes can be mapped to V error types with `map_exception`.
+
+// JavaException is a Java exception as a V error.
+// The `Throwable` is kept as a *global* reference, call `free` when done with the exception.
+pub struct JavaException {
+	Error
+pub:
+	throwable JavaThrowable // global ref
+	context   string        // what was being done when the exception was thrown, e.g. the call signature
+}
+
+// msg returns '<context>: Java exception'. It does not call into Java, see `describe`
+// for the class name and message.
+pub fn (e JavaException) msg() string {
+	return e.context + ': Java exception'
+}
+
+// describe returns '<context>: <class name>: <message>', or '<context>: <class name>'
+// if the exception has no message.
+pub fn (e JavaException) describe(env &Env) string {
+	name := e.class_name(env)
+	message := e.message(env)
+	if message == '' {
+		return e.context + ': ' + name
+	}
+	return e.context + ': ' + name + ': ' + message
+}
+
+// class_name returns the name of the exception's class, e.g. 'java.lang.IllegalStateException'.
+pub fn (e JavaException) class_name(env &Env) string {
+	ids := exception_state().throwable_ids(env)
+	cls := get_object_class(env, JavaObject(e.throwable))
+	name := call_string_method_a(env, JavaObject(cls), ids.class_get_name, void_arg.data)
+	delete_local_ref(env, JavaObject(cls))
+	clear_nested_exception(env)
+	return name
+}
+
+// message returns the result of `Throwable.getMessage()`, or an empty string if there is no message.
+pub fn (e JavaException) message(env &Env) string {
+	ids := exception_state().throwable_ids(env)
+	msg := call_object_method_a(env, JavaObject(e.throwable), ids.get_message, void_arg.data)
+	if isnil(msg) {
+		clear_nested_exception(env)
+		return ''
+	}
+	s := j2v_string(env, JavaString(msg))
+	delete_local_ref(env, msg)
+	return s
+}
+
+// stack_trace returns the stack trace of the exception, one '\tat <frame>' line per frame.
+pub fn (e JavaException) stack_trace(env &Env) string {
+	ids := exception_state().throwable_ids(env)
+	trace := JavaObjectArray(call_object_method_a(env, JavaObject(e.throwable), ids.get_stack_trace,
+		void_arg.data))
+	if isnil(trace) {
+		clear_nested_exception(env)
+		return ''
+	}
+	n := get_array_length(env, JavaArray(trace))
+	mut sb := strings.new_builder(n * 64)
+	for i in 0 .. n {
+		frame := get_object_array_element(env, trace, i)
+		sb.write_string('\tat ')
+		sb.writeln(call_string_method_a(env, frame, ids.element_to_string, void_arg.data))
+		delete_local_ref(env, frame)
+	}
+	delete_local_ref(env, JavaObject(trace))
+	clear_nested_exception(env)
+	return sb.str()
+}
+
+// is_instance_of returns `true` if the exception is an instance of the class `class_name`.
+pub fn (e JavaException) is_instance_of(env &Env, class_name string) bool {
+	cls := class_ref(env, class_name)
+	if isnil(cls) {
+		exception_clear(env)
+		return false
+	}
+	return is_instance_of(env, JavaObject(e.throwable), cls)
+}
+
+// rethrow throws the exception again, e.g. to propagate it back to Java from a native method.
+pub fn (e JavaException) rethrow(env &Env) {
+	throw(env, e.throwable)
+}
+
+// free deletes the global reference to the `Throwable`.
+pub fn (e JavaException) free(env &Env) {
+	if !isnil(e.throwable) {
+		delete_global_ref(env, JavaObject(e.throwable))
+	}
+}
+
+// clear_nested_exception clears an exception thrown while inspecting another exception.
+@[inline]
+fn clear_nested_exception(env &Env) {
+	if exception_check(env) {
+		exception_clear(env)
+	}
+}
+
+// ExceptionMapper converts a `JavaException` to a V error. The mapper owns the exception:
+// it should either keep it in the returned error or `free` it.
+pub type ExceptionMapper = fn (env &Env, e JavaException) IError
+
+struct ExceptionMapping {
+	class  JavaClass // owned by the class registry
+	mapper ExceptionMapper
+}
+
+// ThrowableIDs are the method IDs used to inspect exceptions.
+struct ThrowableIDs {
+	get_message       JavaMethodID
+	get_stack_trace   JavaMethodID
+	class_get_name    JavaMethodID
+	element_to_string JavaMethodID
+}
+
+struct ExceptionState {
+mut:
+	mutex    &sync.RwMutex = sync.new_rwmutex()
+	resolved bool
+	ids      ThrowableIDs
+	mappers  []ExceptionMapping
+}
+
+fn exception_state() &ExceptionState {
+	mut es := unsafe { &ExceptionState(state(.exceptions)) }
+	if isnil(es) {
+		es = unsafe { &ExceptionState(set_state_once(.exceptions, &ExceptionState{})) }
+	}
+	return es
+}
+
+// throwable_ids returns the `Throwable` method IDs, resolving them on first use.
+fn (mut es ExceptionState) throwable_ids(env &Env) ThrowableIDs {
+	es.mutex.@rlock()
+	if es.resolved {
+		ids := es.ids
+		es.mutex.runlock()
+		return ids
+	}
+	es.mutex.runlock()
+
+	throwable := class_ref(env, 'java/lang/Throwable')
+	class := class_ref(env, 'java/lang/Class')
+	element := class_ref(env, 'java/lang/StackTraceElement')
+	ids := ThrowableIDs{
+		get_message:       get_method_id(env, throwable, 'getMessage', '()Ljava/lang/String;')
+		get_stack_trace:   get_method_id(env, throwable, 'getStackTrace', '()[Ljava/lang/StackTraceElement;')
+		class_get_name:    get_method_id(env, class, 'getName', '()Ljava/lang/String;')
+		element_to_string: get_method_id(env, element, 'toString', '()Ljava/lang/String;')
+	}
+	es.mutex.@lock()
+	es.ids = ids
+	es.resolved = true
+	es.mutex.unlock()
+	return ids
+}
+
+// map_exception makes `take_exception` return the error returned by `mapper` for exceptions
+// that are instances of the class `class_name`. Mappings are tried in the order they were added.
+pub fn map_exception(env &Env, class_name string, mapper ExceptionMapper) {
+	cls := class_ref(env, class_name)
+	if isnil(cls) {
+		$if debug {
+			exception_describe(env)
+		}
+		exception_clear(env)
+		panic(@MOD + '.' + @FN + ': could not find class "${class_name}"')
+	}
+	mut es := exception_state()
+	es.mutex.@lock()
+	es.mappers << ExceptionMapping{
+		class:  cls
+		mapper: mapper
+	}
+	es.mutex.unlock()
+}
+
+// clear_exception_state forgets the cached `Throwable` method IDs and all exception mappings.
+// It is called by `on_unload`.
+pub fn clear_exception_state(env &Env) {
+	mut es := exception_state()
+	es.mutex.@lock()
+	es.resolved = false
+	es.ids = ThrowableIDs{}
+	es.mappers.clear()
+	es.mutex.unlock()
+}
+
+// take_exception clears the pending Java exception and returns it as a V error,
+// a `JavaException` or the error of a matching `map_exception` mapper.
+// `context` is used as prefix of the error message.
+pub fn take_exception(env &Env, context string) IError {
+	local := exception_occurred(env)
+	if isnil(local) {
+		return error(context + ': failed without a Java exception')
+	}
+	exception_clear(env)
+	e := JavaException{
+		throwable: JavaThrowable(new_global_ref(env, JavaObject(local)))
+		context:   context
+	}
+	mut es := exception_state()
+	es.mutex.@rlock()
+	for m in es.mappers {
+		if is_instance_of(env, JavaObject(local), m.class) {
+			es.mutex.runlock()
+			delete_local_ref(env, JavaObject(local))
+			return m.mapper(env, e)
+		}
+	}
+	es.mutex.runlock()
+	delete_local_ref(env, JavaObject(local))
+	return e
+}
+
+// check_exception returns the pending Java exception, if any, as an error (see `take_exception`).
+@[inline]
+pub fn check_exception(env &Env, context string) ! {
+	if exception_check(env) {
+		return take_exception(env, context)
+	}
+}
+
+// try_find_class returns the class `name` as a local reference, see `find_class`.
+pub fn try_find_class(env &Env, name string) !JavaClass {
+	cls := find_class_unchecked(env, name.replace('.', '/'))
+	if isnil(cls) {
+		return take_exception(env, @MOD + '.' + @FN + ' "${name}"')
+	}
+	return cls
+}
+
+// try_class_ref returns the class `name` from the class registry, see `class_ref`.
+pub fn try_class_ref(env &Env, name string) !JavaClass {
+	cls := class_ref(env, name)
+	if isnil(cls) {
+		return take_exception(env, @MOD + '.' + @FN + ' "${name}"')
+	}
+	return cls
+}
+
+// try_get_method_id returns the ID of the method `name` with the Java descriptor `sig` on `clazz`.
+pub fn try_get_method_id(env &Env, clazz JavaClass, name string, sig string) !JavaMethodID {
+	mid := C.GetMethodID(env, clazz, name.str, sig.str)
+	if isnil(mid) {
+		return take_exception(env, @MOD + '.' + @FN + ' "${name}${sig}"')
+	}
+	return mid
+}
+
+// try_get_static_method_id returns the ID of the static method `name` with the Java descriptor `sig` on `clazz`.
+pub fn try_get_static_method_id(env &Env, clazz JavaClass, name string, sig string) !JavaMethodID {
+	mid := C.GetStaticMethodID(env, clazz, name.str, sig.str)
+	if isnil(mid) {
+		return take_exception(env, @MOD + '.' + @FN + ' "${name}${sig}"')
+	}
+	return mid
+}
+
+// try_get_field_id returns the ID of the field `name` with the Java type descriptor `sig` on `clazz`.
+pub fn try_get_field_id(env &Env, clazz JavaClass, name string, sig string) !JavaFieldID {
+	fid := C.GetFieldID(env, clazz, name.str, sig.str)
+	if isnil(fid) {
+		return take_exception(env, @MOD + '.' + @FN + ' "${name} ${sig}"')
+	}
+	return fid
+}
+
+// try_get_static_field_id returns the ID of the static field `name` with the Java type descriptor `sig` on `clazz`.
+pub fn try_get_static_field_id(env &Env, clazz JavaClass, name string, sig string) !JavaFieldID {
+	fid := C.GetStaticFieldID(env, clazz, name.str, sig.str)
+	if isnil(fid) {
+		return take_exception(env, @MOD + '.' + @FN + ' "${name} ${sig}"')
+	}
+	return fid
+}
+
+// try_call_static_method calls the static Java method described by `signature`, see `call_static_method`.
+pub fn try_call_static_method(env &Env, signature string, args ...Type) !CallResult {
+	start := stats_now()
+	mut mc := method_cache()
+	method := mc.static_method(env, signature, args)
+	if isnil(method.mid) {
+		return take_exception(env, signature)
+	}
+	result := invoke_static(env, method, args)
+	stats_call(signature, start)
+	if exception_check(env) {
+		return take_exception(env, signature)
+	}
+	return call_result(signature, result)
+}
+
+// try_call_object_method calls the method described by `signature` on `obj`, see `call_object_method`.
+pub fn try_call_object_method(env &Env, obj JavaObject, signature string, args ...Type) !CallResult {
+	start := stats_now()
+	mut mc := method_cache()
+	method := mc.object_method(env, obj, signature, args)
+	if isnil(method.mid) {
+		return take_exception(env, signature)
+	}
+	result := invoke_object(env, obj, method, args)
+	stats_call(signature, start)
+	if exception_check(env) {
+		return take_exception(env, signature)
+	}
+	return call_result(signature, result)
+}
+
+// try_call_static_method_as calls the static Java method described by `signature` and returns
+// the raw result as `R`, see `call_static_method_int` etc.
+pub fn try_call_static_method_as[R](env &Env, signature string, args ...Type) !R {
+	start := stats_now()
+	mut mc := method_cache()
+	method := mc.static_method(env, signature, args)
+	if isnil(method.mid) {
+		return take_exception(env, signature)
+	}
+	$if debug {
+		check_return_kind[R](@FN, signature, method.ret)
+	}
+	result := invoke_static_as[R](env, method, args)
+	stats_call(signature, start)
+	if exception_check(env) {
+		return take_exception(env, signature)
+	}
+	return result
+}
+
+// try_call_object_method_as calls the method described by `signature` on `obj` and returns
+// the raw result as `R`, see `call_object_method_int` etc.
+pub fn try_call_object_method_as[R](env &Env, obj JavaObject, signature string, args ...Type) !R {
+	start := stats_now()
+	mut mc := method_cache()
+	method := mc.object_method(env, obj, signature, args)
+	if isnil(method.mid) {
+		return take_exception(env, signature)
+	}
+	$if debug {
+		check_return_kind[R](@FN, signature, method.ret)
+	}
+	result := invoke_object_as[R](env, obj, method, args)
+	stats_call(signature, start)
+	if exception_check(env) {
+		return take_exception(env, signature)
+	}
+	return result
+}
@@ -0,0 +1,87 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+// LocalFrame is a scope of local references, see `push_local_frame`/`pop_local_frame`.
+// All local references created after `local_frame` are deleted by `pop`,
+// except the one passed to `pop` which is promoted to the enclosing frame.
+//
+// Example:
+// ```v
+// mut frame := jni.local_frame(env, 16)
+// defer {
+//	frame.pop(nil)
+// }
+// ```
+pub struct LocalFrame {
+	env &Env
+mut:
+	popped bool
+}
+
+// local_frame pushes a new local reference frame with room for at least `capacity` local references.
+pub fn local_frame(env &Env, capacity int) LocalFrame {
+	if push_local_frame(env, capacity) < 0 {
+		// An OutOfMemoryError is pending in the JavaVM
+		$if debug {
+			exception_describe(env)
+		}
+		panic(@MOD + '.' + @FN + ': could not push a local frame of ${capacity} references in jni.Env (${ptr_str(env)})')
+	}
+	return LocalFrame{
+		env: env
+	}
+}
+
+// pop pops the frame, deleting all local references created in it.
+// `result` (which may be `nil`) is promoted to the enclosing frame and the new reference is returned.
+// Calling `pop` more than once is a no-op.
+pub fn (mut lf LocalFrame) pop(result JavaObject) JavaObject {
+	if lf.popped {
+		return result
+	}
+	lf.popped = true
+	return pop_local_frame(lf.env, result)
+}
+
+// with_local_frame runs `f` in a new local reference frame with room for `capacity` local references.
+// Every local reference created by `f` is deleted when it returns, except the
+// object `f` returns, which is promoted out of the frame and returned.
+//
+// Example:
+// ```v
+// name := jni.with_local_frame(env, 8, fn (env &jni.Env) jni.JavaObject {
+//	// ... lots of calls creating local references ...
+//	return jni.JavaObject(jni.jstring(env, 'result'))
+// })
+// ```
+pub fn with_local_frame(env &Env, capacity int, f fn (env &Env) JavaObject) JavaObject {
+	mut lf := local_frame(env, capacity)
+	result := f(env)
+	return lf.pop(result)
+}
+
+// needs_local_frame returns `true` if a call with `args` returning `ret` creates local references
+// that would otherwise be left behind in the caller's frame.
+@[inline]
+fn needs_local_frame(ret ValueKind, args []Type) bool {
+	if ret == .string {
+		return true
+	}
+	for arg in args {
+		if arg is string {
+			return true
+		}
+	}
+	return false
+}
+
+// pop_frame_result pops the current local frame, promoting `result` if it is an object.
+@[inline]
+fn pop_frame_result(env &Env, result Type) Type {
+	if result is JavaObject {
+		return Type(pop_local_frame(env, result))
+	}
+	pop_local_frame(env, JavaObject(unsafe { nil }))
+	return result
+}
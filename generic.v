@@ -0,0 +1,392 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+// Statically typed calls.
+//
+// The Java descriptor of these calls is derived from the V types at compile time
+// and arguments are converted without going through the `Type` sum type:
+// ```v
+// f := jni.call_static2[f32, string, int](env, 'io.vlang.V', 'javaFloatFunc', 'Hello', 22)
+// jni.call2[jni.Void, bool, int](env, obj, 'setValues', true, 2)
+// ```
+// V has no variadic generics so there is one function per argument count.
+// Use `Void` as return type for `void` methods and `TypedObject` (see `typed_object`)
+// for arguments of a specific class.
+//
+// The descriptor is built once per instantiation, except for calls with `TypedObject`
+// arguments, whose class is only known at runtime.
+
+// java_type returns the Java type descriptor of the V type `T`.
+@[inline]
+pub fn java_type[T]() string {
+	$if T is Void {
+		return 'V'
+	} $else $if T is bool {
+		return 'Z'
+	} $else $if T is u8 {
+		return 'B'
+	} $else $if T is rune {
+		return 'C'
+	} $else $if T is i16 {
+		return 'S'
+	} $else $if T is int {
+		return 'I'
+	} $else $if T is i64 {
+		return 'J'
+	} $else $if T is f32 {
+		return 'F'
+	} $else $if T is f64 {
+		return 'D'
+	} $else $if T is string || T is JavaString {
+		return 'Ljava/lang/String;'
+	} $else $if T is JavaClass {
+		return 'Ljava/lang/Class;'
+	} $else $if T is JavaObject {
+		return 'Ljava/lang/Object;'
+	} $else {
+		$compile_error('jni.java_type: unsupported V type')
+	}
+	return ''
+}
+
+// jvalue converts `val` to a `JavaValue`. Strings become new local references, which the caller
+// has to delete.
+@[inline]
+pub fn jvalue[T](env &Env, val T) JavaValue {
+	$if T is bool {
+		return JavaValue{
+			z: jboolean(val)
+		}
+	} $else $if T is u8 {
+		return JavaValue{
+			b: jbyte(val)
+		}
+	} $else $if T is rune {
+		return JavaValue{
+			c: jchar(val)
+		}
+	} $else $if T is i16 {
+		return JavaValue{
+			s: jshort(val)
+		}
+	} $else $if T is int {
+		return JavaValue{
+			i: jint(val)
+		}
+	} $else $if T is i64 {
+		return JavaValue{
+			j: jlong(val)
+		}
+	} $else $if T is f32 {
+		return JavaValue{
+			f: jfloat(val)
+		}
+	} $else $if T is f64 {
+		return JavaValue{
+			d: jdouble(val)
+		}
+	} $else $if T is string {
+		return JavaValue{
+			l: JavaObject(jstring(env, val))
+		}
+	} $else $if T is JavaObject || T is JavaString || T is JavaClass {
+		return JavaValue{
+			l: JavaObject(val)
+		}
+	} $else $if T is TypedObject {
+		return JavaValue{
+			l: val.obj
+		}
+	} $else {
+		$compile_error('jni.jvalue: unsupported V type')
+	}
+	return JavaValue{}
+}
+
+// release_jvalue deletes the local reference `jvalue` made for `val`, if any.
+@[inline]
+fn release_jvalue[T](env &Env, val JavaValue) {
+	$if T is string {
+		delete_local_ref(env, val.l)
+	}
+}
+
+// arg_type returns the Java type descriptor of the argument `val`.
+@[inline]
+fn arg_type[T](val T) string {
+	$if T is TypedObject {
+		return val.descriptor
+	} $else {
+		return java_type[T]()
+	}
+}
+
+// StaticString is a string built once and published through a pointer, see `descriptor<n>`.
+struct StaticString {
+	value string
+}
+
+// static_string returns the string published in `slot`, or `none` if there is none yet.
+@[inline]
+fn static_string(slot &voidptr) ?string {
+	p := load_once(slot)
+	if isnil(p) {
+		return none
+	}
+	published := unsafe { &StaticString(p) }
+	return published.value
+}
+
+// publish_string publishes `s` in `slot` unless another thread came first and returns
+// the string that ends up in `slot`.
+fn publish_string(slot &voidptr, s string) string {
+	p := publish_once(slot, &StaticString{
+		value: s
+	})
+	published := unsafe { &StaticString(p) }
+	return published.value
+}
+
+// The descriptor<n> functions return the Java method descriptor of a call with the return type `R`
+// and the argument types `A`, `B`, `C`. The descriptor is built on the first call of each
+// instantiation and published through a static pointer, so no thread sees it half written.
+
+@[unsafe]
+fn descriptor0[R]() string {
+	mut static desc := voidptr(0)
+	return static_string(&desc) or { publish_string(&desc, '()' + java_type[R]()) }
+}
+
+@[unsafe]
+fn descriptor1[R, A](a A) string {
+	$if A is TypedObject {
+		return '(' + a.descriptor + ')' + java_type[R]()
+	} $else {
+		mut static desc := voidptr(0)
+		return static_string(&desc) or {
+			publish_string(&desc, '(' + java_type[A]() + ')' + java_type[R]())
+		}
+	}
+}
+
+@[unsafe]
+fn descriptor2[R, A, B](a A, b B) string {
+	$if A is TypedObject || B is TypedObject {
+		return '(' + arg_type(a) + arg_type(b) + ')' + java_type[R]()
+	} $else {
+		mut static desc := voidptr(0)
+		return static_string(&desc) or {
+			publish_string(&desc, '(' + java_type[A]() + java_type[B]() + ')' + java_type[R]())
+		}
+	}
+}
+
+@[unsafe]
+fn descriptor3[R, A, B, C](a A, b B, c C) string {
+	$if A is TypedObject || B is TypedObject || C is TypedObject {
+		return '(' + arg_type(a) + arg_type(b) + arg_type(c) + ')' + java_type[R]()
+	} $else {
+		mut static desc := voidptr(0)
+		return static_string(&desc) or {
+			publish_string(&desc, '(' + java_type[A]() + java_type[B]() + java_type[C]() + ')' +
+				java_type[R]())
+		}
+	}
+}
+
+fn static_ret[R](env &Env, class JavaClass, mid JavaMethodID, args &JavaValue) R {
+	$if R is Void {
+		call_static_void_method_a(env, class, mid, args)
+		return Void(false)
+	} $else $if R is bool {
+		return call_static_boolean_method_a(env, class, mid, args)
+	} $else $if R is u8 {
+		return call_static_byte_method_a(env, class, mid, args)
+	} $else $if R is rune {
+		return call_static_char_method_a(env, class, mid, args)
+	} $else $if R is i16 {
+		return call_static_short_method_a(env, class, mid, args)
+	} $else $if R is int {
+		return call_static_int_method_a(env, class, mid, args)
+	} $else $if R is i64 {
+		return call_static_long_method_a(env, class, mid, args)
+	} $else $if R is f32 {
+		return call_static_float_method_a(env, class, mid, args)
+	} $else $if R is f64 {
+		return call_static_double_method_a(env, class, mid, args)
+	} $else $if R is string {
+		return call_static_string_method_a(env, class, mid, args)
+	} $else $if R is JavaObject || R is JavaString || R is JavaClass {
+		return R(call_static_object_method_a(env, class, mid, args))
+	} $else {
+		$compile_error('jni.call_static: unsupported V return type')
+	}
+}
+
+fn object_ret[R](env &Env, obj JavaObject, mid JavaMethodID, args &JavaValue) R {
+	$if R is Void {
+		call_void_method_a(env, obj, mid, args)
+		return Void(false)
+	} $else $if R is bool {
+		return call_boolean_method_a(env, obj, mid, args)
+	} $else $if R is u8 {
+		return call_byte_method_a(env, obj, mid, args)
+	} $else $if R is rune {
+		return call_char_method_a(env, obj, mid, args)
+	} $else $if R is i16 {
+		return call_short_method_a(env, obj, mid, args)
+	} $else $if R is int {
+		return call_int_method_a(env, obj, mid, args)
+	} $else $if R is i64 {
+		return call_long_method_a(env, obj, mid, args)
+	} $else $if R is f32 {
+		return call_float_method_a(env, obj, mid, args)
+	} $else $if R is f64 {
+		return call_double_method_a(env, obj, mid, args)
+	} $else $if R is string {
+		return call_string_method_a(env, obj, mid, args)
+	} $else $if R is JavaObject || R is JavaString || R is JavaClass {
+		return R(call_object_method_a(env, obj, mid, args))
+	} $else {
+		$compile_error('jni.call: unsupported V return type')
+	}
+}
+
+// call_static0 calls the static method `name` taking no arguments on `class`.
+pub fn call_static0[R](env &Env, class string, name string) R {
+	start := stats_now()
+	mut mc := method_cache()
+	m := mc.static_method_desc(env, class, name, unsafe { descriptor0[R]() })
+	if isnil(m.mid) {
+		check_method(env, m.mid, class + '.' + name)
+	}
+	r := static_ret[R](env, m.class, m.mid, void_arg.data)
+	$if jni_stats ? {
+		stats_call(class + '.' + name, start)
+	}
+	return r
+}
+
+// call_static1 calls the static method `name(A)` on `class`.
+pub fn call_static1[R, A](env &Env, class string, name string, a A) R {
+	start := stats_now()
+	mut mc := method_cache()
+	m := mc.static_method_desc(env, class, name, unsafe { descriptor1[R, A](a) })
+	if isnil(m.mid) {
+		check_method(env, m.mid, class + '.' + name)
+	}
+	args := [jvalue(env, a)]!
+	r := static_ret[R](env, m.class, m.mid, &args[0])
+	release_jvalue[A](env, args[0])
+	$if jni_stats ? {
+		stats_call(class + '.' + name, start)
+	}
+	return r
+}
+
+// call_static2 calls the static method `name(A, B)` on `class`.
+pub fn call_static2[R, A, B](env &Env, class string, name string, a A, b B) R {
+	start := stats_now()
+	mut mc := method_cache()
+	m := mc.static_method_desc(env, class, name, unsafe { descriptor2[R, A, B](a, b) })
+	if isnil(m.mid) {
+		check_method(env, m.mid, class + '.' + name)
+	}
+	args := [jvalue(env, a), jvalue(env, b)]!
+	r := static_ret[R](env, m.class, m.mid, &args[0])
+	release_jvalue[A](env, args[0])
+	release_jvalue[B](env, args[1])
+	$if jni_stats ? {
+		stats_call(class + '.' + name, start)
+	}
+	return r
+}
+
+// call_static3 calls the static method `name(A, B, C)` on `class`.
+pub fn call_static3[R, A, B, C](env &Env, class string, name string, a A, b B, c C) R {
+	start := stats_now()
+	mut mc := method_cache()
+	m := mc.static_method_desc(env, class, name, unsafe { descriptor3[R, A, B, C](a, b, c) })
+	if isnil(m.mid) {
+		check_method(env, m.mid, class + '.' + name)
+	}
+	args := [jvalue(env, a), jvalue(env, b), jvalue(env, c)]!
+	r := static_ret[R](env, m.class, m.mid, &args[0])
+	release_jvalue[A](env, args[0])
+	release_jvalue[B](env, args[1])
+	release_jvalue[C](env, args[2])
+	$if jni_stats ? {
+		stats_call(class + '.' + name, start)
+	}
+	return r
+}
+
+// call0 calls the method `name` taking no arguments on `obj`.
+pub fn call0[R](env &Env, obj JavaObject, name string) R {
+	start := stats_now()
+	mut mc := method_cache()
+	m := mc.object_method_desc(env, obj, name, unsafe { descriptor0[R]() })
+	if isnil(m.mid) {
+		check_method(env, m.mid, name)
+	}
+	r := object_ret[R](env, obj, m.mid, void_arg.data)
+	$if jni_stats ? {
+		stats_call(name, start)
+	}
+	return r
+}
+
+// call1 calls the method `name(A)` on `obj`.
+pub fn call1[R, A](env &Env, obj JavaObject, name string, a A) R {
+	start := stats_now()
+	mut mc := method_cache()
+	m := mc.object_method_desc(env, obj, name, unsafe { descriptor1[R, A](a) })
+	if isnil(m.mid) {
+		check_method(env, m.mid, name)
+	}
+	args := [jvalue(env, a)]!
+	r := object_ret[R](env, obj, m.mid, &args[0])
+	release_jvalue[A](env, args[0])
+	$if jni_stats ? {
+		stats_call(name, start)
+	}
+	return r
+}
+
+// call2 calls the method `name(A, B)` on `obj`.
+pub fn call2[R, A, B](env &Env, obj JavaObject, name string, a A, b B) R {
+	start := stats_now()
+	mut mc := method_cache()
+	m := mc.object_method_desc(env, obj, name, unsafe { descriptor2[R, A, B](a, b) })
+	if isnil(m.mid) {
+		check_method(env, m.mid, name)
+	}
+	args := [jvalue(env, a), jvalue(env, b)]!
+	r := object_ret[R](env, obj, m.mid, &args[0])
+	release_jvalue[A](env, args[0])
+	release_jvalue[B](env, args[1])
+	$if jni_stats ? {
+		stats_call(name, start)
+	}
+	return r
+}
+
+// call3 calls the method `name(A, B, C)` on `obj`.
+pub fn call3[R, A, B, C](env &Env, obj JavaObject, name string, a A, b B, c C) R {
+	start := stats_now()
+	mut mc := method_cache()
+	m := mc.object_method_desc(env, obj, name, unsafe { descriptor3[R, A, B, C](a, b, c) })
+	if isnil(m.mid) {
+		check_method(env, m.mid, name)
+	}
+	args := [jvalue(env, a), jvalue(env, b), jvalue(env, c)]!
+	r := object_ret[R](env, obj, m.mid, &args[0])
+	release_jvalue[A](env, args[0])
+	release_jvalue[B](env, args[1])
+	release_jvalue[C](env, args[2])
+	$if jni_stats ? {
+		stats_call(name, start)
+	}
+	return r
+}
@@ -0,0 +1,212 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module host
+
+import os
+import time
+import jni
+
+// Embedded JavaVM.
+//
+// `jni.host` creates a JavaVM inside a V executable, for V programs that use Java libraries
+// and for running JNI code (benchmarks, tests) headlessly. It links `libjvm` from `$JAVA_HOME`.
+//
+// Example:
+// ```v
+// import jni
+// import jni.host
+//
+// fn main() {
+//	mut vm := host.create(classpath: ['build/classes'], max_heap: '256m')!
+//	defer {
+//		vm.destroy() or { panic(err) }
+//	}
+//	vm.load_class('io.vlang.V')!
+//	println(jni.call_static_method_int(vm.env, 'io.vlang.V.getInt() int'))
+//	println(vm.report())
+// }
+// ```
+
+#flag -DV_JNI_HOST
+
+$if linux {
+	#flag -L $env('JAVA_HOME')/lib/server
+	#flag -Wl,-rpath,$env('JAVA_HOME')/lib/server
+}
+
+$if darwin {
+	#flag -L $env('JAVA_HOME')/lib/server
+	#flag -Wl,-rpath,$env('JAVA_HOME')/lib/server
+}
+
+$if windows {
+	#flag -L $env('JAVA_HOME')/lib
+}
+
+#flag -ljvm
+
+fn C.gCreateJavaVM(version int, options &&char, n int, ignore_unrecognized u8, env &&C.JNIEnv) int
+fn C.gCreatedJavaVM() &C.JavaVM
+fn C.gDestroyJavaVM() int
+
+// Jit selects how the JavaVM executes bytecode.
+pub enum Jit {
+	default     // mixed mode, interpreted until hot
+	interpreted // -Xint
+	compiled    // -Xcomp, compile every method on first call
+}
+
+// Options configures the JavaVM created by `create`.
+pub struct Options {
+pub:
+	version             jni.Version = .v1_8
+	classpath           []string // joined with the platform's path separator to `-Djava.class.path`
+	min_heap            string   // `-Xms`, e.g. '64m'
+	max_heap            string   // `-Xmx`, e.g. '1g'
+	stack_size          string   // `-Xss`, e.g. '1m'
+	jit                 Jit
+	properties          map[string]string // `-D<key>=<value>`
+	options             []string          // any other JavaVM option, e.g. '-XX:+UseSerialGC' or '-verbose:jni'
+	ignore_unrecognized bool              // skip unknown `-X`/`_` options instead of failing
+}
+
+// StartupTimings are the durations of the startup phases of an embedded JavaVM.
+pub struct StartupTimings {
+pub mut:
+	create_vm   time.Duration // `JNI_CreateJavaVM`
+	first_class time.Duration // the first `load_class`
+	first_name  string        // the class loaded first
+}
+
+// JVM is a JavaVM in this process and the `Env` of the thread that created or attached it.
+@[heap]
+pub struct JVM {
+pub:
+	vm      &jni.JavaVM
+	env     &jni.Env
+	owned   bool // created by `create`, destroyed by `destroy`
+	options []string
+pub mut:
+	timings StartupTimings
+mut:
+	destroyed bool
+}
+
+// vm_options returns the JavaVM option strings for `opts`.
+pub fn (opts Options) vm_options() []string {
+	mut res := []string{}
+	if opts.classpath.len > 0 {
+		res << '-Djava.class.path=' + opts.classpath.join(os.path_delimiter)
+	}
+	if opts.min_heap != '' {
+		res << '-Xms' + opts.min_heap
+	}
+	if opts.max_heap != '' {
+		res << '-Xmx' + opts.max_heap
+	}
+	if opts.stack_size != '' {
+		res << '-Xss' + opts.stack_size
+	}
+	match opts.jit {
+		.default {}
+		.interpreted { res << '-Xint' }
+		.compiled { res << '-Xcomp' }
+	}
+	mut keys := opts.properties.keys()
+	keys.sort()
+	for key in keys {
+		res << '-D${key}=${opts.properties[key]}'
+	}
+	res << opts.options
+	return res
+}
+
+// create starts a JavaVM in this process, makes it the `jni` default JavaVM and
+// attaches the calling thread. A process can only have one JavaVM, and once destroyed
+// a JavaVM can not be created again.
+pub fn create(opts Options) !&JVM {
+	if !isnil(C.gCreatedJavaVM()) {
+		return error(@MOD + '.' + @FN + ': a JavaVM already exists in this process, use `host.existing()`')
+	}
+	options := opts.vm_options()
+	mut cstrs := []&char{cap: options.len}
+	for o in options {
+		cstrs << &char(o.str)
+	}
+	mut env := &jni.Env(unsafe { nil })
+	sw := time.new_stopwatch()
+	res := C.gCreateJavaVM(int(opts.version), cstrs.data, options.len, u8(opts.ignore_unrecognized),
+		&env)
+	elapsed := sw.elapsed()
+	if res != 0 {
+		return error(@MOD + '.' + @FN + ': JNI_CreateJavaVM failed (${res}) with options ${options}')
+	}
+	j := &JVM{
+		vm:      jni.default_vm()
+		env:     env
+		owned:   true
+		options: options
+		timings: StartupTimings{
+			create_vm: elapsed
+		}
+	}
+	$if debug ? {
+		eprintln(@MOD + '.' + @FN + ': created JavaVM in ${elapsed} with ${options}')
+	}
+	return j
+}
+
+// existing returns the JavaVM already running in this process, e.g. when V is loaded by Java,
+// makes it the `jni` default JavaVM and attaches the calling thread.
+pub fn existing() !&JVM {
+	vm := C.gCreatedJavaVM()
+	if isnil(vm) {
+		return error(@MOD + '.' + @FN + ': no JavaVM in this process, use `host.create()`')
+	}
+	jni.set_java_vm(vm)
+	return &JVM{
+		vm:  vm
+		env: jni.attach_current_thread('V main')
+	}
+}
+
+// load_class returns the class `name` from the `jni` class registry, loading it if needed.
+// The duration of the first call is recorded in `timings`.
+pub fn (mut j JVM) load_class(name string) !jni.JavaClass {
+	if j.timings.first_name != '' {
+		return jni.try_class_ref(j.env, name)!
+	}
+	sw := time.new_stopwatch()
+	cls := jni.try_class_ref(j.env, name)!
+	j.timings.first_class = sw.elapsed()
+	j.timings.first_name = name
+	return cls
+}
+
+// report returns a summary of the startup timings.
+pub fn (j &JVM) report() string {
+	mut s := 'JavaVM ${ptr_str(j.vm)}: create ${j.timings.create_vm}'
+	if j.timings.first_name != '' {
+		s += ', first class load (${j.timings.first_name}) ${j.timings.first_class}'
+	}
+	return s
+}
+
+// destroy releases the global references held by `jni` and, for JavaVMs created by `create`,
+// unloads the JavaVM. It waits for all non-daemon Java threads to finish.
+// No `jni` function can be used afterwards.
+pub fn (mut j JVM) destroy() ! {
+	if j.destroyed {
+		return
+	}
+	j.destroyed = true
+	jni.on_unload(j.vm)
+	if !j.owned {
+		jni.detach_current_thread()
+		return
+	}
+	res := C.gDestroyJavaVM()
+	if res != 0 {
+		return error(@MOD + '.' + @FN + ': DestroyJavaVM failed (${res})')
+	}
+}
@@ -0,0 +1,94 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+package io.vlang.jni;
+
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/* EventRing is the Java (consumer) side of `jni.EventRing`.
+* V writes length-prefixed records into a direct ByteBuffer, this class
+* drains them in bulk. See ring.v for the memory layout.
+*
+* Typical use from the doorbell method:
+*
+*	static void onEvents() {
+*		do {
+*			ring.drain(record -> handle(record));
+*		} while (!ring.idle());
+*	}
+*
+* Requires Java 9+ (VarHandle).
+*/
+public class EventRing
+{
+	public interface Handler {
+		void onEvent(ByteBuffer record);
+	}
+
+	private static final int HEADER_SIZE = 128;
+	private static final int HEAD_OFFSET = 0;
+	private static final int TAIL_OFFSET = 64;
+	private static final int WAITING_OFFSET = 72;
+	private static final int PADDING = 0xFFFFFFFF;
+
+	private static final VarHandle LONGS = MethodHandles.byteBufferViewVarHandle(long[].class, ByteOrder.nativeOrder());
+	private static final VarHandle INTS = MethodHandles.byteBufferViewVarHandle(int[].class, ByteOrder.nativeOrder());
+
+	private final ByteBuffer header;
+	private final ByteBuffer data;
+	private final int mask;
+	private long tail;
+
+	public EventRing(ByteBuffer buffer) {
+		if (!buffer.isDirect()) {
+			throw new IllegalArgumentException("EventRing needs a direct ByteBuffer");
+		}
+		header = buffer.duplicate().order(ByteOrder.nativeOrder());
+		ByteBuffer records = buffer.duplicate();
+		records.position(HEADER_SIZE);
+		data = records.slice().order(ByteOrder.nativeOrder());
+		mask = data.capacity() - 1;
+		tail = (long) LONGS.getAcquire(header, TAIL_OFFSET);
+	}
+
+	/* drain passes every record written since the last drain to `handler`
+	* and returns the number of records. The ByteBuffer passed to `handler`
+	* is only valid during the call.
+	*/
+	public int drain(Handler handler) {
+		long head = (long) LONGS.getAcquire(header, HEAD_OFFSET);
+		int n = 0;
+		while (tail < head) {
+			int pos = (int) (tail & mask);
+			int len = data.getInt(pos);
+			if (len == PADDING) {
+				tail += data.capacity() - pos;
+				continue;
+			}
+			ByteBuffer record = data.duplicate();
+			record.position(pos + 4);
+			record.limit(pos + 4 + len);
+			handler.onEvent(record.slice().order(ByteOrder.nativeOrder()));
+			tail += (4 + len + 7) & ~7;
+			n++;
+		}
+		// Hand the space back to the producer
+		LONGS.setRelease(header, TAIL_OFFSET, tail);
+		return n;
+	}
+
+	/* idle tells the producer to ring the doorbell on the next write.
+	* It returns false if records arrived in the meantime, in which case
+	* the caller should drain again instead of waiting.
+	*/
+	public boolean idle() {
+		INTS.setVolatile(header, WAITING_OFFSET, 1);
+		if ((long) LONGS.getVolatile(header, HEAD_OFFSET) != tail) {
+			INTS.setVolatile(header, WAITING_OFFSET, 0);
+			return false;
+		}
+		return true;
+	}
+}
@@ -147,15 +147,41 @@ pub union C.jvalue {
 // fn C.MethodIDToObject(cls C.jmethodID) C.jobject
 
 fn C.gGetEnv() &C.JNIEnv
+fn C.gEnvOf(vm &C.JavaVM) &C.JNIEnv
 
 fn C.gEnvNeedDetach(env &&C.JNIEnv) bool
 fn C.gDetachThread()
+fn C.gAttachThread(name &char) &C.JNIEnv
+fn C.gAttachCountGet() u64
+fn C.gDetachCountGet() u64
 
 fn C.gGetJavaVM() &C.JavaVM
 fn C.gSetJavaVM(vm &JavaVM)
 
+fn C.gGetState(slot int) voidptr
+fn C.gSetStateOnce(slot int, state voidptr) voidptr
+fn C.gLoadOnce(ptr &voidptr) voidptr
+fn C.gPublishOnce(ptr &voidptr, value voidptr) voidptr
+
+fn C.gCriticalEnter()
+fn C.gCriticalExit()
+fn C.gCriticalRegionsHeld() int
+
+fn C.gStatsLocalRefs(delta int)
+fn C.gStatsPushFrame()
+fn C.gStatsPopFrame(kept int)
+fn C.gStatsLocalRefsHighWater() int
+fn C.gStatsResetLocalRefs()
+fn C.gStatsMax(max &u64, value u64)
+
 fn C.gFindClass(name &char) C.jclass
 
+fn C.gClassGet(name &char, len int) C.jclass
+fn C.gClassPut(name &char, len int, cls C.jclass) C.jclass
+fn C.gClassClear(env &C.JNIEnv)
+
+fn C.gRegisterNatives(env &C.JNIEnv, cls C.jclass, names &&char, signatures &&char, fns &voidptr, n int) C.jint
+
 fn C.gSetupAndroid(name &char)
 
 // jni.h / jni_wrapper.h
@@ -178,6 +204,9 @@ pub fn find_class(env &Env, name string) JavaClass {
 		panic(@MOD + '.' + @FN + ': JNI environment pointer jni.Env(${ptr_str(env)})" is invalid')
 	}
 	n := name.replace('.', '/')
+	$if jni_stats ? {
+		C.gStatsLocalRefs(1)
+	}
 	$if debug {
 		mut cls := JavaClass(unsafe { nil }) // C.jclass(0)
 		$if android {
@@ -203,6 +232,18 @@ pub fn find_class(env &Env, name string) JavaClass {
 	return C.FindClass(env, n.str)
 }
 
+// find_class_unchecked looks up the class `name` ('pkg/Class' form) without checking for exceptions.
+// `nil` is returned, with a Java exception pending, if the class could not be found.
+fn find_class_unchecked(env &Env, name string) JavaClass {
+	$if jni_stats ? {
+		C.gStatsLocalRefs(1)
+	}
+	$if android {
+		return C.gFindClass(name.str)
+	}
+	return C.FindClass(env, name.str)
+}
+
 fn C.FromReflectedMethod(env &C.JNIEnv, method C.jobject) C.jmethodID
 pub fn from_reflected_method(env &Env, method JavaObject) JavaMethodID {
 	return C.FromReflectedMethod(env, method)
@@ -245,7 +286,9 @@ pub fn throw_new(env &Env, clazz JavaClass, msg string) int {
 
 fn C.ExceptionOccurred(env &Env) C.jthrowable
 pub fn exception_occurred(env &Env) JavaThrowable {
-	return C.ExceptionOccurred(env)
+	exc := C.ExceptionOccurred(env)
+	stats_local_ref(exc)
+	return exc
 }
 
 fn C.ExceptionDescribe(env &Env)
@@ -265,11 +308,20 @@ pub fn fatal_error(env &Env, msg string) {
 
 fn C.PushLocalFrame(env &C.JNIEnv, capacity C.jint) C.jint
 pub fn push_local_frame(env &Env, capacity int) int {
-	return j2v_int(C.PushLocalFrame(env, jint(capacity)))
+	res := j2v_int(C.PushLocalFrame(env, jint(capacity)))
+	$if jni_stats ? {
+		if res == 0 {
+			C.gStatsPushFrame()
+		}
+	}
+	return res
 }
 
 fn C.PopLocalFrame(env &C.JNIEnv, result C.jobject) C.jobject
 pub fn pop_local_frame(env &Env, result JavaObject) JavaObject {
+	$if jni_stats ? {
+		C.gStatsPopFrame(if isnil(result) { 0 } else { 1 })
+	}
 	return C.PopLocalFrame(env, result)
 }
 
@@ -285,6 +337,11 @@ pub fn delete_global_ref(env &Env, gref JavaObject) {
 
 fn C.DeleteLocalRef(env &C.JNIEnv, obj C.jobject)
 pub fn delete_local_ref(env &Env, obj JavaObject) {
+	$if jni_stats ? {
+		if !isnil(obj) {
+			C.gStatsLocalRefs(-1)
+		}
+	}
 	C.DeleteLocalRef(env, obj)
 }
 
@@ -295,7 +352,9 @@ pub fn is_same_object(env &Env, obj1 JavaObject, obj2 JavaObject) bool {
 
 fn C.NewLocalRef(env &C.JNIEnv, ref C.jobject) C.jobject
 pub fn new_local_ref(env &Env, ref JavaObject) JavaObject {
-	return C.NewLocalRef(env, ref)
+	obj := C.NewLocalRef(env, ref)
+	stats_local_ref(obj)
+	return obj
 }
 
 fn C.EnsureLocalCapacity(env &C.JNIEnv, capacity C.jint) C.jint
@@ -318,11 +377,16 @@ pub fn alloc_object(env &Env, clazz JavaClass) JavaObject {
 //}
 fn C.NewObjectA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jobject
 pub fn new_object_a(env &Env, clazz JavaClass, methodID JavaMethodID, args &JavaValue) JavaObject {
-	return C.NewObjectA(env, clazz, methodID, args)
+	obj := C.NewObjectA(env, clazz, methodID, args)
+	stats_local_ref(obj)
+	return obj
 }
 
 fn C.GetObjectClass(env &C.JNIEnv, obj C.jobject) C.jclass
 pub fn get_object_class(env &Env, obj JavaObject) JavaClass {
+	$if jni_stats ? {
+		C.gStatsLocalRefs(1)
+	}
 	$if debug {
 		clazz := C.GetObjectClass(env, obj)
 		if exception_check(env) {
@@ -372,14 +436,21 @@ pub fn get_method_id(env &Env, clazz JavaClass, name string, sig string) JavaMet
 //}
 fn C.CallObjectMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jobject
 pub fn call_object_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) JavaObject {
-	return C.CallObjectMethodA(env, obj, method_id, args)
+	$if debug {
+		check_not_critical(@FN)
+	}
+	res := C.CallObjectMethodA(env, obj, method_id, args)
+	stats_local_ref(res)
+	return res
 }
 
 pub fn call_string_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) string {
 	jobject := call_object_method_a(env, obj, method_id, args)
 	jstr := &JavaString(voidptr(&jobject))
 	// jstr := C.ObjectToString(call_object_method_a(env, obj, mid, jv_args.data))
-	return j2v_string(env, jstr)
+	s := j2v_string(env, jstr)
+	delete_local_ref(env, jobject)
+	return s
 }
 
 // fn C.CallBooleanMethod(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, ...) C.jboolean
@@ -392,6 +463,9 @@ pub fn call_string_method_a(env &Env, obj JavaObject, method_id JavaMethodID, ar
 //}
 fn C.CallBooleanMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jboolean
 pub fn call_boolean_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) bool {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_boolean(C.CallBooleanMethodA(env, obj, method_id, args))
 }
 
@@ -405,6 +479,9 @@ pub fn call_boolean_method_a(env &Env, obj JavaObject, method_id JavaMethodID, a
 //}
 fn C.CallByteMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jbyte
 pub fn call_byte_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) u8 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_byte(C.CallByteMethodA(env, obj, method_id, args))
 }
 
@@ -418,6 +495,9 @@ pub fn call_byte_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args
 //}
 fn C.CallCharMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jchar
 pub fn call_char_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) rune {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_char(C.CallCharMethodA(env, obj, method_id, args))
 }
 
@@ -431,6 +511,9 @@ pub fn call_char_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args
 //}
 fn C.CallShortMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jshort
 pub fn call_short_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) i16 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_short(C.CallShortMethodA(env, obj, method_id, args))
 }
 
@@ -444,6 +527,9 @@ pub fn call_short_method_a(env &Env, obj JavaObject, method_id JavaMethodID, arg
 //}
 fn C.CallIntMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jint
 pub fn call_int_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) int {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_int(C.CallIntMethodA(env, obj, method_id, args))
 }
 
@@ -457,6 +543,9 @@ pub fn call_int_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args
 //}
 fn C.CallLongMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jlong
 pub fn call_long_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) i64 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_long(C.CallLongMethodA(env, obj, method_id, args))
 }
 
@@ -470,6 +559,9 @@ pub fn call_long_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args
 //}
 fn C.CallFloatMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jfloat
 pub fn call_float_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) f32 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_float(C.CallFloatMethodA(env, obj, method_id, args))
 }
 
@@ -483,6 +575,9 @@ pub fn call_float_method_a(env &Env, obj JavaObject, method_id JavaMethodID, arg
 //}
 fn C.CallDoubleMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue) C.jdouble
 pub fn call_double_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) f64 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_double(C.CallDoubleMethodA(env, obj, method_id, args))
 }
 
@@ -496,6 +591,9 @@ pub fn call_double_method_a(env &Env, obj JavaObject, method_id JavaMethodID, ar
 //}
 fn C.CallVoidMethodA(env &C.JNIEnv, obj C.jobject, methodID C.jmethodID, args &C.jvalue)
 pub fn call_void_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args &JavaValue) {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	C.CallVoidMethodA(env, obj, method_id, args)
 }
 
@@ -511,13 +609,18 @@ pub fn call_void_method_a(env &Env, obj JavaObject, method_id JavaMethodID, args
 //}
 fn C.CallNonvirtualObjectMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jobject
 pub fn call_nonvirtual_object_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) JavaObject {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return C.CallNonvirtualObjectMethodA(env, obj, clazz, method_id, args)
 }
 
 pub fn call_nonvirtual_string_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) string {
 	jobject := call_nonvirtual_object_method_a(env, obj, clazz, method_id, args)
 	jstr := &JavaString(voidptr(&jobject))
-	return j2v_string(env, jstr)
+	s := j2v_string(env, jstr)
+	delete_local_ref(env, jobject)
+	return s
 }
 
 // fn C.CallNonvirtualBooleanMethod(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, ...) C.jboolean
@@ -530,6 +633,9 @@ pub fn call_nonvirtual_string_method_a(env &Env, obj JavaObject, clazz JavaClass
 //}
 fn C.CallNonvirtualBooleanMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jboolean
 pub fn call_nonvirtual_boolean_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) bool {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_boolean(C.CallNonvirtualBooleanMethodA(env, obj, clazz, method_id, args))
 }
 
@@ -543,6 +649,9 @@ pub fn call_nonvirtual_boolean_method_a(env &Env, obj JavaObject, clazz JavaClas
 //}
 fn C.CallNonvirtualByteMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jbyte
 pub fn call_nonvirtual_byte_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) u8 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_byte(C.CallNonvirtualByteMethodA(env, obj, clazz, method_id, args))
 }
 
@@ -556,6 +665,9 @@ pub fn call_nonvirtual_byte_method_a(env &Env, obj JavaObject, clazz JavaClass,
 //}
 fn C.CallNonvirtualCharMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jchar
 pub fn call_nonvirtual_char_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) rune {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_char(C.CallNonvirtualCharMethodA(env, obj, clazz, method_id, args))
 }
 
@@ -569,6 +681,9 @@ pub fn call_nonvirtual_char_method_a(env &Env, obj JavaObject, clazz JavaClass,
 //}
 fn C.CallNonvirtualShortMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jshort
 pub fn call_nonvirtual_short_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) i16 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_short(C.CallNonvirtualShortMethodA(env, obj, clazz, method_id, args))
 }
 
@@ -582,6 +697,9 @@ pub fn call_nonvirtual_short_method_a(env &Env, obj JavaObject, clazz JavaClass,
 //}
 fn C.CallNonvirtualIntMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jint
 pub fn call_nonvirtual_int_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) int {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_int(C.CallNonvirtualIntMethodA(env, obj, clazz, method_id, args))
 }
 
@@ -595,6 +713,9 @@ pub fn call_nonvirtual_int_method_a(env &Env, obj JavaObject, clazz JavaClass, m
 //}
 fn C.CallNonvirtualLongMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jlong
 pub fn call_nonvirtual_long_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) i64 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_long(C.CallNonvirtualLongMethodA(env, obj, clazz, method_id, args))
 }
 
@@ -608,6 +729,9 @@ pub fn call_nonvirtual_long_method_a(env &Env, obj JavaObject, clazz JavaClass,
 //}
 fn C.CallNonvirtualFloatMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jfloat
 pub fn call_nonvirtual_float_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) f32 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_float(C.CallNonvirtualFloatMethodA(env, obj, clazz, method_id, args))
 }
 
@@ -621,6 +745,9 @@ pub fn call_nonvirtual_float_method_a(env &Env, obj JavaObject, clazz JavaClass,
 //}
 fn C.CallNonvirtualDoubleMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jdouble
 pub fn call_nonvirtual_double_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) f64 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_double(C.CallNonvirtualDoubleMethodA(env, obj, clazz, method_id, args))
 }
 
@@ -634,6 +761,9 @@ pub fn call_nonvirtual_double_method_a(env &Env, obj JavaObject, clazz JavaClass
 //}
 fn C.CallNonvirtualVoidMethodA(env &C.JNIEnv, obj C.jobject, clazz C.jclass, methodID C.jmethodID, args &C.jvalue)
 pub fn call_nonvirtual_void_method_a(env &Env, obj JavaObject, clazz JavaClass, method_id JavaMethodID, args &JavaValue) {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	C.CallNonvirtualVoidMethodA(env, obj, clazz, method_id, args)
 }
 
@@ -646,13 +776,17 @@ pub fn get_field_id(env &Env, clazz JavaClass, name string, sig string) JavaFiel
 //
 fn C.GetObjectField(env &C.JNIEnv, obj C.jobject, fieldID C.jfieldID) C.jobject
 pub fn get_object_field(env &Env, obj JavaObject, field_id JavaFieldID) JavaObject {
-	return C.GetObjectField(env, obj, field_id)
+	res := C.GetObjectField(env, obj, field_id)
+	stats_local_ref(res)
+	return res
 }
 
 pub fn get_string_field(env &Env, obj JavaObject, field_id JavaFieldID) string {
 	jobject := get_object_field(env, obj, field_id)
 	jstr := &JavaString(voidptr(&jobject))
-	return j2v_string(env, jstr)
+	s := j2v_string(env, jstr)
+	delete_local_ref(env, jobject)
+	return s
 }
 
 fn C.GetBooleanField(env &C.JNIEnv, obj C.jobject, fieldID C.jfieldID) C.jboolean
@@ -705,6 +839,7 @@ pub fn set_string_field(env &Env, obj JavaObject, field_id JavaFieldID, val stri
 	jstr := jstring(env, val)
 	// jobj := &JavaObject(voidptr(&jstr))
 	set_object_field(env, obj, field_id, jstr)
+	delete_local_ref(env, jstr)
 }
 
 fn C.SetBooleanField(env &C.JNIEnv, obj C.jobject, fieldID C.jfieldID, val C.jboolean)
@@ -778,14 +913,21 @@ pub fn get_static_method_id(env &Env, clazz JavaClass, name string, sig string)
 //}
 fn C.CallStaticObjectMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jobject
 pub fn call_static_object_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) JavaObject {
-	return C.CallStaticObjectMethodA(env, clazz, method_id, args)
+	$if debug {
+		check_not_critical(@FN)
+	}
+	res := C.CallStaticObjectMethodA(env, clazz, method_id, args)
+	stats_local_ref(res)
+	return res
 }
 
 pub fn call_static_string_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) string {
 	jobject := call_static_object_method_a(env, clazz, method_id, args)
 	jstr := &JavaString(voidptr(&jobject))
 	// jstr :=  C.ObjectToString(call_static_object_method_a(env, class, mid, jv_args.data))
-	return j2v_string(env, jstr)
+	s := j2v_string(env, jstr)
+	delete_local_ref(env, jobject)
+	return s
 }
 
 // fn C.CallStaticBooleanMethod(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, ...) C.jboolean
@@ -798,6 +940,9 @@ pub fn call_static_string_method_a(env &Env, clazz JavaClass, method_id JavaMeth
 //}
 fn C.CallStaticBooleanMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jboolean
 pub fn call_static_boolean_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) bool {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_boolean(C.CallStaticBooleanMethodA(env, clazz, method_id, args))
 }
 
@@ -811,6 +956,9 @@ pub fn call_static_boolean_method_a(env &Env, clazz JavaClass, method_id JavaMet
 //}
 fn C.CallStaticByteMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jbyte
 pub fn call_static_byte_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) u8 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_byte(C.CallStaticByteMethodA(env, clazz, method_id, args))
 }
 
@@ -824,6 +972,9 @@ pub fn call_static_byte_method_a(env &Env, clazz JavaClass, method_id JavaMethod
 //}
 fn C.CallStaticCharMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jchar
 pub fn call_static_char_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) rune {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_char(C.CallStaticCharMethodA(env, clazz, method_id, args))
 }
 
@@ -837,6 +988,9 @@ pub fn call_static_char_method_a(env &Env, clazz JavaClass, method_id JavaMethod
 //}
 fn C.CallStaticShortMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jshort
 pub fn call_static_short_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) i16 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_short(C.CallStaticShortMethodA(env, clazz, method_id, args))
 }
 
@@ -850,6 +1004,9 @@ pub fn call_static_short_method_a(env &Env, clazz JavaClass, method_id JavaMetho
 //}
 fn C.CallStaticIntMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jint
 pub fn call_static_int_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) int {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_int(C.CallStaticIntMethodA(env, clazz, method_id, args))
 }
 
@@ -863,6 +1020,9 @@ pub fn call_static_int_method_a(env &Env, clazz JavaClass, method_id JavaMethodI
 //}
 fn C.CallStaticLongMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jlong
 pub fn call_static_long_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) i64 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_long(C.CallStaticLongMethodA(env, clazz, method_id, args))
 }
 
@@ -876,6 +1036,9 @@ pub fn call_static_long_method_a(env &Env, clazz JavaClass, method_id JavaMethod
 //}
 fn C.CallStaticFloatMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jfloat
 pub fn call_static_float_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) f32 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_float(C.CallStaticFloatMethodA(env, clazz, method_id, args))
 }
 
@@ -889,6 +1052,9 @@ pub fn call_static_float_method_a(env &Env, clazz JavaClass, method_id JavaMetho
 //}
 fn C.CallStaticDoubleMethodA(env &C.JNIEnv, clazz C.jclass, methodID C.jmethodID, args &C.jvalue) C.jdouble
 pub fn call_static_double_method_a(env &Env, clazz JavaClass, method_id JavaMethodID, args &JavaValue) f64 {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	return j2v_double(C.CallStaticDoubleMethodA(env, clazz, method_id, args))
 }
 
@@ -902,6 +1068,9 @@ pub fn call_static_double_method_a(env &Env, clazz JavaClass, method_id JavaMeth
 //}
 fn C.CallStaticVoidMethodA(env &C.JNIEnv, cls C.jclass, methodID C.jmethodID, args &C.jvalue)
 pub fn call_static_void_method_a(env &Env, cls JavaClass, method_id JavaMethodID, args &JavaValue) {
+	$if debug {
+		check_not_critical(@FN)
+	}
 	C.CallStaticVoidMethodA(env, cls, method_id, args)
 }
 
@@ -913,7 +1082,17 @@ pub fn get_static_field_id(env &Env, clazz JavaClass, name string, sig string) J
 
 fn C.GetStaticObjectField(env &C.JNIEnv, clazz C.jclass, fieldID C.jfieldID) C.jobject
 pub fn get_static_object_field(env &Env, clazz JavaClass, field_id JavaFieldID) JavaObject {
-	return C.GetStaticObjectField(env, clazz, field_id)
+	res := C.GetStaticObjectField(env, clazz, field_id)
+	stats_local_ref(res)
+	return res
+}
+
+pub fn get_static_string_field(env &Env, clazz JavaClass, field_id JavaFieldID) string {
+	jobject := get_static_object_field(env, clazz, field_id)
+	jstr := &JavaString(voidptr(&jobject))
+	s := j2v_string(env, jstr)
+	delete_local_ref(env, jobject)
+	return s
 }
 
 fn C.GetStaticBooleanField(env &C.JNIEnv, clazz C.jclass, fieldID C.jfieldID) C.jboolean
@@ -1004,10 +1183,9 @@ pub fn set_static_double_field(env &Env, clazz JavaClass, field_id JavaFieldID,
 
 //
 fn C.NewString(env &C.JNIEnv, unicode &C.jchar, len C.jsize) C.jstring
-pub fn new_string(env &Env, unicode string) JavaString { //, len int
-	// TODO
-	// mut uc := []rune{}
-	return C.NewString(env, unicode.str, jsize(unicode.len))
+// new_string returns a new Java string with the contents of `unicode` (encoded as UTF-16).
+pub fn new_string(env &Env, unicode string) JavaString {
+	return encode_string(env, unicode)
 }
 
 fn C.GetStringLength(env &C.JNIEnv, str C.jstring) C.jsize
@@ -1016,16 +1194,33 @@ pub fn get_string_length(env &Env, str JavaString) int {
 }
 
 fn C.GetStringChars(env &C.JNIEnv, str C.jstring, isCopy &C.jboolean) &C.jchar
+// get_string_chars returns the code points of `str`. The characters are always
+// copied (surrogate pairs combined) so the returned bool is always `true`.
 pub fn get_string_chars(env &Env, str JavaString) ([]rune, bool) {
-	// TODO
-	return []rune{}, false
-	// return C.GetStringChars(env, str, &is_copy)
+	len := get_string_length(env, str)
+	mut units := []u16{len: len}
+	if len > 0 {
+		get_string_region(env, str, 0, len, &units[0])
+	}
+	mut runes := []rune{cap: len}
+	mut i := 0
+	for i < len {
+		c := units[i]
+		i++
+		if c >= 0xD800 && c <= 0xDBFF && i < len && units[i] >= 0xDC00 && units[i] <= 0xDFFF {
+			runes << rune(0x10000 + ((u32(c) - 0xD800) << 10) + (u32(units[i]) - 0xDC00))
+			i++
+			continue
+		}
+		runes << rune(c)
+	}
+	return runes, true
 }
 
 fn C.ReleaseStringChars(env &C.JNIEnv, str C.jstring, chars &C.jchar)
+
+// release_string_chars is a no-op since `get_string_chars` returns a copy.
 pub fn release_string_chars(env &Env, str JavaString, chars []rune) {
-	// TODO
-	C.ReleaseStringChars(env, str, chars.data)
 }
 
 fn C.NewStringUTF(env &C.JNIEnv, utf &char) C.jstring
@@ -1065,7 +1260,9 @@ pub fn new_object_array(env &Env, len int, clazz JavaClass, init JavaObject) Jav
 
 fn C.GetObjectArrayElement(env &C.JNIEnv, array C.jobjectArray, index C.jsize) C.jobject
 pub fn get_object_array_element(env &Env, array JavaObjectArray, index int) JavaObject {
-	return C.GetObjectArrayElement(env, array, jsize(index))
+	res := C.GetObjectArrayElement(env, array, jsize(index))
+	stats_local_ref(res)
+	return res
 }
 
 pub fn (a JavaObjectArray) at(env &Env, index int) JavaObject {
@@ -1168,6 +1365,13 @@ fn C.ReleaseStringCritical(env &C.JNIEnv, string C.jstring, cstring &C.jchar)
 
 fn C.NewWeakGlobalRef(env &C.JNIEnv, obj C.jobject) C.jweak
 fn C.DeleteWeakGlobalRef(env &C.JNIEnv, ref C.jweak)
+pub fn new_weak_global_ref(env &Env, obj JavaObject) JavaObject {
+	return C.NewWeakGlobalRef(env, obj)
+}
+
+pub fn delete_weak_global_ref(env &Env, ref JavaObject) {
+	C.DeleteWeakGlobalRef(env, ref)
+}
 
 fn C.ExceptionCheck(env &C.JNIEnv) C.jboolean
 pub fn exception_check(env &Env) bool {
@@ -1177,6 +1381,17 @@ pub fn exception_check(env &Env) bool {
 fn C.NewDirectByteBuffer(env &C.JNIEnv, address voidptr, capacity C.jlong) C.jobject
 fn C.GetDirectBufferAddress(env &C.JNIEnv, buf C.jobject) voidptr
 fn C.GetDirectBufferCapacity(env &C.JNIEnv, buf C.jobject) C.jlong
+pub fn new_direct_byte_buffer(env &Env, address voidptr, capacity i64) JavaObject {
+	return C.NewDirectByteBuffer(env, address, jlong(capacity))
+}
+
+pub fn get_direct_buffer_address(env &Env, buf JavaObject) voidptr {
+	return C.GetDirectBufferAddress(env, buf)
+}
+
+pub fn get_direct_buffer_capacity(env &Env, buf JavaObject) i64 {
+	return j2v_long(C.GetDirectBufferCapacity(env, buf))
+}
 
 // New JNI 1.6 Features
 
@@ -1189,3 +1404,6 @@ pub enum JObjectRefType {
 }
 
 fn C.GetObjectRefType(env &C.JNIEnv, obj C.jobject) JObjectRefType
+pub fn get_object_ref_type(env &Env, obj JavaObject) JObjectRefType {
+	return C.GetObjectRefType(env, obj)
+}
@@ -9,17 +9,34 @@ pub const used_import = c.used_import
 
 pub const void_arg = []JavaValue{}
 
+// max_stack_args is the number of arguments the typed calls convert without allocating.
+const max_stack_args = 8
+
 pub struct CallResult {
 pub:
-	call string
+	call string // the signature of the call, only recorded when compiled with `-d trace_calls`
 	//	method_type MethodType
 	result Type // TODO = Void ??
 }
 
+// call_result returns a `CallResult` for `result`, recording `signature` only when tracing calls.
+@[inline]
+fn call_result(signature string, result Type) CallResult {
+	$if trace_calls ? {
+		return CallResult{
+			call:   signature
+			result: result
+		}
+	}
+	return CallResult{
+		result: result
+	}
+}
+
 //
 pub fn throw_exception(env &Env, msg string) {
 	exception_clear(env)
-	cls := find_class(env, 'java/lang/Exception')
+	cls := class_ref(env, 'java/lang/Exception')
 	throw_new(env, cls, msg)
 }
 
@@ -34,7 +51,17 @@ pub fn panic_on_exception(env &Env) {
 pub fn sig(pkg string, f_name string, rt Type, args ...Type) string {
 	mut vtypargs := ''
 	for arg in args {
-		vtypargs += arg.type_name() + ', '
+		vtypargs += match arg {
+			TypedObject {
+				// Array descriptors, e.g. '[I', are passed through as they are
+				if arg.descriptor.starts_with('[') {
+					arg.descriptor
+				} else {
+					arg.descriptor[1..arg.descriptor.len - 1].replace('/', '.')
+				}
+			}
+			else { arg.type_name() }
+		} + ', '
 	}
 
 	mut return_type := ' ' + rt.type_name()
@@ -72,235 +99,598 @@ fn parse_signature(fqn_sig string) (string, string) {
 	return fqn, return_type
 }
 
-//
+// call_static_method calls the static Java method described by `signature`.
+// The class and method ID are resolved on first use and cached (see `method_cache_stats`).
 pub fn call_static_method(env &Env, signature string, args ...Type) CallResult {
-	fqn, return_type := parse_signature(signature)
-
-	mut jv_args := []JavaValue{}
-	mut jargs := ''
-
-	for vt in args {
-		jargs += v2j_signature_type(env, vt)
-		jv_args << v2j_value(env, vt)
+	$if debug {
+		check_not_critical(@FN)
 	}
-	jdef := fqn + '(' + jargs + ')' + v2j_string_signature_type(return_type)
-	$if debug_signatures ? {
-		println(@MOD + '.' + @FN + ' Java call style definition: "${fqn} -> ${jdef}"')
+	start := stats_now()
+	mut mc := method_cache()
+	method := mc.static_method(env, signature, args)
+	check_method(env, method.mid, signature)
+	res := call_result(signature, invoke_static(env, method, args))
+	stats_call(signature, start)
+	// Check for any exceptions
+	$if debug {
+		if exception_check(env) {
+			exception_describe(env)
+			excp := 'An exception occured while executing "${signature}" in JNIEnv (${ptr_str(env)})'
+			panic(excp)
+		}
 	}
-	class, mid := get_class_static_method_id(env, jdef)
+	return res
+}
 
-	mut call_result := CallResult{}
-	//
-	if return_type.contains('/') || return_type.contains('.') {
-		call_result = CallResult{
-			call:   signature
-			result: call_static_boolean_method_a(env, class, mid, jv_args.data)
-		}
-	} else {
-		call_result = match return_type {
-			'bool' {
-				CallResult{
-					call:   signature
-					result: call_static_boolean_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'u8' {
-				CallResult{
-					call:   signature
-					result: call_static_byte_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'rune' {
-				CallResult{
-					call:   signature
-					result: call_static_char_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'i16' {
-				CallResult{
-					call:   signature
-					result: call_static_short_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'int' {
-				CallResult{
-					call:   signature
-					result: call_static_int_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'i64' {
-				CallResult{
-					call:   signature
-					result: call_static_long_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'f32' {
-				CallResult{
-					call:   signature
-					result: call_static_float_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'f64' {
-				CallResult{
-					call:   signature
-					result: call_static_double_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'string' {
-				CallResult{
-					call:   signature
-					result: call_static_string_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'object' {
-				CallResult{
-					call:   signature
-					result: call_static_object_method_a(env, class, mid, jv_args.data)
-				}
-			}
-			'void' {
-				call_static_void_method_a(env, class, mid, jv_args.data)
-				CallResult{
-					call: signature
-					// result: Void{}
-				}
-			}
-			else {
-				CallResult{}
-			}
-		}
+// call_object_method calls the method described by `signature` on `obj`.
+// The method ID is resolved on first use and cached per receiver class.
+pub fn call_object_method(env &Env, obj JavaObject, signature string, args ...Type) CallResult {
+	$if debug {
+		check_not_critical(@FN)
 	}
+	start := stats_now()
+	mut mc := method_cache()
+	method := mc.object_method(env, obj, signature, args)
+	check_method(env, method.mid, signature)
+	res := call_result(signature, invoke_object(env, obj, method, args))
+	stats_call(signature, start)
 	// Check for any exceptions
 	$if debug {
 		if exception_check(env) {
 			exception_describe(env)
-			excp := 'An exception occured while executing "${signature}" in JNIEnv (${ptr_str(env)})'
+			excp := @MOD + '.' + @FN +
+				' an exception occured while executing "${signature}" in JNIEnv (${ptr_str(env)})'
+			// throw_exception(env, excp)
 			panic(excp)
 		}
 	}
-	return call_result
+	return res
 }
 
-pub fn call_object_method(env &Env, obj JavaObject, signature string, args ...Type) CallResult {
-	fqn, return_type := parse_signature(signature)
+// check_method panics, describing the pending Java exception, if a method could not be resolved.
+@[inline]
+fn check_method(env &Env, mid JavaMethodID, signature string) {
+	if isnil(mid) {
+		if exception_check(env) {
+			exception_describe(env)
+			exception_clear(env)
+		}
+		panic(@MOD + '.' + @FN + ': could not find method "${signature}" in jni.Env (${ptr_str(env)})')
+	}
+}
 
-	mut jv_args := []JavaValue{}
-	mut jargs := ''
+// check_field panics, describing the pending Java exception, if a field could not be resolved.
+@[inline]
+fn check_field(env &Env, fid JavaFieldID, field string) {
+	if isnil(fid) {
+		if exception_check(env) {
+			exception_describe(env)
+			exception_clear(env)
+		}
+		panic(@MOD + '.' + @FN + ': could not find field "${field}" in jni.Env (${ptr_str(env)})')
+	}
+}
 
-	for vt in args {
-		jargs += v2j_signature_type(env, vt)
-		jv_args << v2j_value(env, vt)
+// java_args converts `args` to Java values in `stack`, which has room for `max_stack_args` values,
+// or in `heap` for calls with more arguments.
+@[direct_array_access; inline]
+fn java_args(env &Env, args []Type, stack &JavaValue, mut heap []JavaValue) &JavaValue {
+	mut jv_args := unsafe { stack }
+	if args.len > max_stack_args {
+		heap = []JavaValue{len: args.len}
+		jv_args = unsafe { &JavaValue(heap.data) }
 	}
-	jdef := fqn + '(' + jargs + ')' + v2j_string_signature_type(return_type)
-	$if debug_signatures ? {
-		println(@MOD + '.' + @FN + ' Java call style definition: "${fqn} -> ${jdef}"')
+	for i, vt in args {
+		unsafe {
+			jv_args[i] = v2j_value(env, vt)
+		}
 	}
-	_, mid := get_object_class_and_method_id(env, obj, jdef)
+	return jv_args
+}
 
-	mut call_result := CallResult{}
-	//
-	if return_type.contains('/') || return_type.contains('.') {
-		call_result = CallResult{
-			call:   signature
-			result: call_object_method_a(env, obj, mid, jv_args.data)
-		}
-	} else {
-		call_result = match return_type {
-			'bool' {
-				CallResult{
-					call:   signature
-					result: call_boolean_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'u8' {
-				CallResult{
-					call:   signature
-					result: call_byte_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'rune' {
-				CallResult{
-					call:   signature
-					result: call_char_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'i16' {
-				CallResult{
-					call:   signature
-					result: call_short_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'int' {
-				CallResult{
-					call:   signature
-					result: call_int_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'i64' {
-				CallResult{
-					call:   signature
-					result: call_long_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'f32' {
-				CallResult{
-					call:   signature
-					result: call_float_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'f64' {
-				CallResult{
-					call:   signature
-					result: call_double_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'string' {
-				CallResult{
-					call:   signature
-					result: call_string_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'object' {
-				CallResult{
-					call:   signature
-					result: call_object_method_a(env, obj, mid, jv_args.data)
-				}
-			}
-			'void' {
-				call_void_method_a(env, obj, mid, jv_args.data)
-				CallResult{
-					call: signature
-				}
-			}
-			else {
-				CallResult{}
-			}
+// invoke_static calls the resolved static `method` with `args`.
+fn invoke_static(env &Env, method MethodCacheEntry, args []Type) Type {
+	// Local references created for arguments and results are released with the frame
+	frame := needs_local_frame(method.ret, args)
+	if frame {
+		local_frame(env, args.len + 1)
+	}
+	mut stack := [max_stack_args]JavaValue{}
+	mut heap := []JavaValue{}
+	jv_args := java_args(env, args, &stack[0], mut heap)
+	result := static_result(env, method.class, method.mid, method.ret, jv_args)
+	if frame {
+		return pop_frame_result(env, result)
+	}
+	return result
+}
+
+// invoke_object calls the resolved `method` on `obj` with `args`.
+fn invoke_object(env &Env, obj JavaObject, method MethodCacheEntry, args []Type) Type {
+	frame := needs_local_frame(method.ret, args)
+	if frame {
+		local_frame(env, args.len + 1)
+	}
+	mut stack := [max_stack_args]JavaValue{}
+	mut heap := []JavaValue{}
+	jv_args := java_args(env, args, &stack[0], mut heap)
+	result := object_result(env, obj, method.mid, method.ret, jv_args)
+	if frame {
+		return pop_frame_result(env, result)
+	}
+	return result
+}
+
+// Typed calls.
+//
+// The `call_static_method_<type>` and `call_object_method_<type>` variants take the same
+// signatures and arguments as `call_static_method` and `call_object_method` but return the
+// raw result, without boxing it in a `Type`. Calls with up to `max_stack_args` arguments
+// convert them on the stack.
+// ```v
+// n := jni.call_static_method_int(env, 'io.vlang.V.getInt() int')
+// s := jni.call_object_method_string(env, obj, 'toString() string')
+// ```
+// The arguments of these variants are still boxed in a `Type` and passed as an array.
+// `call_static_method<n>` and `call_object_method<n>` take up to 3 arguments as they are
+// and allocate nothing once the method is cached. They are the `call_static<n>` and `call<n>`
+// calls of generic.v, with the class and method name taken from the signature:
+// ```v
+// r := jni.call_static_method2[int, bool, int](env, 'io.vlang.V.mixedArguments(bool, int) int', true, 4)
+// ```
+
+// value_kind_of returns the `ValueKind` of the V type `R`.
+@[inline]
+fn value_kind_of[R]() ValueKind {
+	$if R is Void {
+		return .void
+	} $else $if R is bool {
+		return .bool
+	} $else $if R is u8 {
+		return .u8
+	} $else $if R is rune {
+		return .rune
+	} $else $if R is i16 {
+		return .i16
+	} $else $if R is int {
+		return .int
+	} $else $if R is i64 {
+		return .i64
+	} $else $if R is f32 {
+		return .f32
+	} $else $if R is f64 {
+		return .f64
+	} $else $if R is string {
+		return .string
+	} $else {
+		return .object
+	}
+}
+
+// check_return_kind panics if a method returning `ret` is called through a variant returning `R`.
+fn check_return_kind[R](caller string, signature string, ret ValueKind) {
+	kind := value_kind_of[R]()
+	// Strings are objects too
+	if kind != ret && !(kind == .object && ret == .string) {
+		panic(@MOD + '.' + caller + ': "${signature}" returns ${ret}, not ${kind}')
+	}
+}
+
+// static_method_as calls the static Java method described by `signature` and returns the result as `R`.
+fn static_method_as[R](env &Env, signature string, args []Type) R {
+	$if debug {
+		check_not_critical(@FN)
+	}
+	start := stats_now()
+	mut mc := method_cache()
+	method := mc.static_method(env, signature, args)
+	check_method(env, method.mid, signature)
+	$if debug {
+		check_return_kind[R](@FN, signature, method.ret)
+	}
+	result := invoke_static_as[R](env, method, args)
+	stats_call(signature, start)
+	$if debug {
+		if exception_check(env) {
+			exception_describe(env)
+			panic(@MOD + '.' + @FN +
+				' an exception occured while executing "${signature}" in JNIEnv (${ptr_str(env)})')
 		}
 	}
-	// Check for any exceptions
+	return result
+}
+
+// object_method_as calls the method described by `signature` on `obj` and returns the result as `R`.
+fn object_method_as[R](env &Env, obj JavaObject, signature string, args []Type) R {
+	$if debug {
+		check_not_critical(@FN)
+	}
+	start := stats_now()
+	mut mc := method_cache()
+	method := mc.object_method(env, obj, signature, args)
+	check_method(env, method.mid, signature)
+	$if debug {
+		check_return_kind[R](@FN, signature, method.ret)
+	}
+	result := invoke_object_as[R](env, obj, method, args)
+	stats_call(signature, start)
 	$if debug {
 		if exception_check(env) {
 			exception_describe(env)
-			excp := @MOD + '.' + @FN +
-				' an exception occured while executing "${signature}" in JNIEnv (${ptr_str(env)})'
-			// throw_exception(env, excp)
-			panic(excp)
+			panic(@MOD + '.' + @FN +
+				' an exception occured while executing "${signature}" in JNIEnv (${ptr_str(env)})')
+		}
+	}
+	return result
+}
+
+// invoke_static_as calls the resolved static `method` with `args` and returns the result as `R`.
+fn invoke_static_as[R](env &Env, method MethodCacheEntry, args []Type) R {
+	frame := needs_local_frame(method.ret, args)
+	if frame {
+		local_frame(env, args.len + 1)
+	}
+	mut stack := [max_stack_args]JavaValue{}
+	mut heap := []JavaValue{}
+	jv_args := java_args(env, args, &stack[0], mut heap)
+	mut result := static_ret[R](env, method.class, method.mid, jv_args)
+	if frame {
+		$if R is JavaObject || R is JavaString || R is JavaClass {
+			result = R(pop_local_frame(env, JavaObject(result)))
+		} $else {
+			pop_local_frame(env, JavaObject(unsafe { nil }))
+		}
+	}
+	return result
+}
+
+// invoke_object_as calls the resolved `method` on `obj` with `args` and returns the result as `R`.
+fn invoke_object_as[R](env &Env, obj JavaObject, method MethodCacheEntry, args []Type) R {
+	frame := needs_local_frame(method.ret, args)
+	if frame {
+		local_frame(env, args.len + 1)
+	}
+	mut stack := [max_stack_args]JavaValue{}
+	mut heap := []JavaValue{}
+	jv_args := java_args(env, args, &stack[0], mut heap)
+	mut result := object_ret[R](env, obj, method.mid, jv_args)
+	if frame {
+		$if R is JavaObject || R is JavaString || R is JavaClass {
+			result = R(pop_local_frame(env, JavaObject(result)))
+		} $else {
+			pop_local_frame(env, JavaObject(unsafe { nil }))
+		}
+	}
+	return result
+}
+
+// call_static_method_void calls the static `void` Java method described by `signature`.
+@[inline]
+pub fn call_static_method_void(env &Env, signature string, args ...Type) {
+	static_method_as[Void](env, signature, args)
+}
+
+// call_static_method_bool calls the static Java method described by `signature` returning a `bool`.
+@[inline]
+pub fn call_static_method_bool(env &Env, signature string, args ...Type) bool {
+	return static_method_as[bool](env, signature, args)
+}
+
+// call_static_method_u8 calls the static Java method described by `signature` returning a `u8`.
+@[inline]
+pub fn call_static_method_u8(env &Env, signature string, args ...Type) u8 {
+	return static_method_as[u8](env, signature, args)
+}
+
+// call_static_method_rune calls the static Java method described by `signature` returning a `rune`.
+@[inline]
+pub fn call_static_method_rune(env &Env, signature string, args ...Type) rune {
+	return static_method_as[rune](env, signature, args)
+}
+
+// call_static_method_i16 calls the static Java method described by `signature` returning a `i16`.
+@[inline]
+pub fn call_static_method_i16(env &Env, signature string, args ...Type) i16 {
+	return static_method_as[i16](env, signature, args)
+}
+
+// call_static_method_int calls the static Java method described by `signature` returning a `int`.
+@[inline]
+pub fn call_static_method_int(env &Env, signature string, args ...Type) int {
+	return static_method_as[int](env, signature, args)
+}
+
+// call_static_method_i64 calls the static Java method described by `signature` returning a `i64`.
+@[inline]
+pub fn call_static_method_i64(env &Env, signature string, args ...Type) i64 {
+	return static_method_as[i64](env, signature, args)
+}
+
+// call_static_method_f32 calls the static Java method described by `signature` returning a `f32`.
+@[inline]
+pub fn call_static_method_f32(env &Env, signature string, args ...Type) f32 {
+	return static_method_as[f32](env, signature, args)
+}
+
+// call_static_method_f64 calls the static Java method described by `signature` returning a `f64`.
+@[inline]
+pub fn call_static_method_f64(env &Env, signature string, args ...Type) f64 {
+	return static_method_as[f64](env, signature, args)
+}
+
+// call_static_method_string calls the static Java method described by `signature` returning a `string`.
+@[inline]
+pub fn call_static_method_string(env &Env, signature string, args ...Type) string {
+	return static_method_as[string](env, signature, args)
+}
+
+// call_static_method_object calls the static Java method described by `signature` returning an object (a local reference).
+@[inline]
+pub fn call_static_method_object(env &Env, signature string, args ...Type) JavaObject {
+	return static_method_as[JavaObject](env, signature, args)
+}
+
+// call_object_method_void calls the `void` method described by `signature` on `obj`.
+@[inline]
+pub fn call_object_method_void(env &Env, obj JavaObject, signature string, args ...Type) {
+	object_method_as[Void](env, obj, signature, args)
+}
+
+// call_object_method_bool calls the method described by `signature` on `obj` returning a `bool`.
+@[inline]
+pub fn call_object_method_bool(env &Env, obj JavaObject, signature string, args ...Type) bool {
+	return object_method_as[bool](env, obj, signature, args)
+}
+
+// call_object_method_u8 calls the method described by `signature` on `obj` returning a `u8`.
+@[inline]
+pub fn call_object_method_u8(env &Env, obj JavaObject, signature string, args ...Type) u8 {
+	return object_method_as[u8](env, obj, signature, args)
+}
+
+// call_object_method_rune calls the method described by `signature` on `obj` returning a `rune`.
+@[inline]
+pub fn call_object_method_rune(env &Env, obj JavaObject, signature string, args ...Type) rune {
+	return object_method_as[rune](env, obj, signature, args)
+}
+
+// call_object_method_i16 calls the method described by `signature` on `obj` returning a `i16`.
+@[inline]
+pub fn call_object_method_i16(env &Env, obj JavaObject, signature string, args ...Type) i16 {
+	return object_method_as[i16](env, obj, signature, args)
+}
+
+// call_object_method_int calls the method described by `signature` on `obj` returning a `int`.
+@[inline]
+pub fn call_object_method_int(env &Env, obj JavaObject, signature string, args ...Type) int {
+	return object_method_as[int](env, obj, signature, args)
+}
+
+// call_object_method_i64 calls the method described by `signature` on `obj` returning a `i64`.
+@[inline]
+pub fn call_object_method_i64(env &Env, obj JavaObject, signature string, args ...Type) i64 {
+	return object_method_as[i64](env, obj, signature, args)
+}
+
+// call_object_method_f32 calls the method described by `signature` on `obj` returning a `f32`.
+@[inline]
+pub fn call_object_method_f32(env &Env, obj JavaObject, signature string, args ...Type) f32 {
+	return object_method_as[f32](env, obj, signature, args)
+}
+
+// call_object_method_f64 calls the method described by `signature` on `obj` returning a `f64`.
+@[inline]
+pub fn call_object_method_f64(env &Env, obj JavaObject, signature string, args ...Type) f64 {
+	return object_method_as[f64](env, obj, signature, args)
+}
+
+// call_object_method_string calls the method described by `signature` on `obj` returning a `string`.
+@[inline]
+pub fn call_object_method_string(env &Env, obj JavaObject, signature string, args ...Type) string {
+	return object_method_as[string](env, obj, signature, args)
+}
+
+// call_object_method_object calls the method described by `signature` on `obj` returning an object (a local reference).
+@[inline]
+pub fn call_object_method_object(env &Env, obj JavaObject, signature string, args ...Type) JavaObject {
+	return object_method_as[JavaObject](env, obj, signature, args)
+}
+
+// split_signature returns the class and the method name of the V `jni` style `signature`,
+// e.g. 'io.vlang.V' and 'getInt' for 'io.vlang.V.getInt() int'. The class is empty if
+// `signature` has none. Both are slices of `signature`, nothing is copied.
+@[direct_array_access]
+fn split_signature(signature string) (string, string) {
+	mut paren := signature.index_u8(`(`)
+	if paren < 0 {
+		paren = signature.len
+	}
+	mut dot := paren - 1
+	for dot >= 0 && signature[dot] != `.` {
+		dot--
+	}
+	if dot < 0 {
+		return '', unsafe { signature.substr_unsafe(0, paren) }
+	}
+	return unsafe { signature.substr_unsafe(0, dot) }, unsafe { signature.substr_unsafe(dot + 1, paren) }
+}
+
+// check_signature_return panics if `signature` does not return the V type `R`.
+fn check_signature_return[R](caller string, signature string) {
+	_, return_type := parse_signature(signature)
+	check_return_kind[R](caller, signature, value_kind(return_type))
+}
+
+// call_static_method0 calls the static Java method described by `signature` with no arguments
+// and returns the result as `R`, see `call_static0`.
+pub fn call_static_method0[R](env &Env, signature string) R {
+	$if debug {
+		check_signature_return[R](@FN, signature)
+	}
+	class, name := split_signature(signature)
+	return call_static0[R](env, class, name)
+}
+
+// call_static_method1 calls the static Java method described by `signature` with the argument `a`
+// and returns the result as `R`, see `call_static1`.
+pub fn call_static_method1[R, A](env &Env, signature string, a A) R {
+	$if debug {
+		check_signature_return[R](@FN, signature)
+	}
+	class, name := split_signature(signature)
+	return call_static1[R, A](env, class, name, a)
+}
+
+// call_static_method2 calls the static Java method described by `signature` with the arguments `a` and `b`
+// and returns the result as `R`, see `call_static2`.
+pub fn call_static_method2[R, A, B](env &Env, signature string, a A, b B) R {
+	$if debug {
+		check_signature_return[R](@FN, signature)
+	}
+	class, name := split_signature(signature)
+	return call_static2[R, A, B](env, class, name, a, b)
+}
+
+// call_static_method3 calls the static Java method described by `signature` with the arguments `a`, `b` and `c`
+// and returns the result as `R`, see `call_static3`.
+pub fn call_static_method3[R, A, B, C](env &Env, signature string, a A, b B, c C) R {
+	$if debug {
+		check_signature_return[R](@FN, signature)
+	}
+	class, name := split_signature(signature)
+	return call_static3[R, A, B, C](env, class, name, a, b, c)
+}
+
+// call_object_method0 calls the method described by `signature` on `obj` with no arguments
+// and returns the result as `R`, see `call0`.
+pub fn call_object_method0[R](env &Env, obj JavaObject, signature string) R {
+	$if debug {
+		check_signature_return[R](@FN, signature)
+	}
+	_, name := split_signature(signature)
+	return call0[R](env, obj, name)
+}
+
+// call_object_method1 calls the method described by `signature` on `obj` with the argument `a`
+// and returns the result as `R`, see `call1`.
+pub fn call_object_method1[R, A](env &Env, obj JavaObject, signature string, a A) R {
+	$if debug {
+		check_signature_return[R](@FN, signature)
+	}
+	_, name := split_signature(signature)
+	return call1[R, A](env, obj, name, a)
+}
+
+// call_object_method2 calls the method described by `signature` on `obj` with the arguments `a` and `b`
+// and returns the result as `R`, see `call2`.
+pub fn call_object_method2[R, A, B](env &Env, obj JavaObject, signature string, a A, b B) R {
+	$if debug {
+		check_signature_return[R](@FN, signature)
+	}
+	_, name := split_signature(signature)
+	return call2[R, A, B](env, obj, name, a, b)
+}
+
+// call_object_method3 calls the method described by `signature` on `obj` with the arguments `a`, `b` and `c`
+// and returns the result as `R`, see `call3`.
+pub fn call_object_method3[R, A, B, C](env &Env, obj JavaObject, signature string, a A, b B, c C) R {
+	$if debug {
+		check_signature_return[R](@FN, signature)
+	}
+	_, name := split_signature(signature)
+	return call3[R, A, B, C](env, obj, name, a, b, c)
+}
+
+// static_result calls the static method `mid` on `class` with the call function matching `ret`.
+fn static_result(env &Env, class JavaClass, mid JavaMethodID, ret ValueKind, args &JavaValue) Type {
+	return match ret {
+		.bool {
+			Type(call_static_boolean_method_a(env, class, mid, args))
+		}
+		.u8 {
+			Type(call_static_byte_method_a(env, class, mid, args))
+		}
+		.rune {
+			Type(call_static_char_method_a(env, class, mid, args))
+		}
+		.i16 {
+			Type(call_static_short_method_a(env, class, mid, args))
+		}
+		.int {
+			Type(call_static_int_method_a(env, class, mid, args))
+		}
+		.i64 {
+			Type(call_static_long_method_a(env, class, mid, args))
+		}
+		.f32 {
+			Type(call_static_float_method_a(env, class, mid, args))
+		}
+		.f64 {
+			Type(call_static_double_method_a(env, class, mid, args))
+		}
+		.string {
+			Type(call_static_string_method_a(env, class, mid, args))
+		}
+		.object {
+			Type(call_static_object_method_a(env, class, mid, args))
+		}
+		.void {
+			call_static_void_method_a(env, class, mid, args)
+			Type(Void(false))
+		}
+	}
+}
+
+// object_result calls the method `mid` on `obj` with the call function matching `ret`.
+fn object_result(env &Env, obj JavaObject, mid JavaMethodID, ret ValueKind, args &JavaValue) Type {
+	return match ret {
+		.bool {
+			Type(call_boolean_method_a(env, obj, mid, args))
+		}
+		.u8 {
+			Type(call_byte_method_a(env, obj, mid, args))
+		}
+		.rune {
+			Type(call_char_method_a(env, obj, mid, args))
+		}
+		.i16 {
+			Type(call_short_method_a(env, obj, mid, args))
+		}
+		.int {
+			Type(call_int_method_a(env, obj, mid, args))
+		}
+		.i64 {
+			Type(call_long_method_a(env, obj, mid, args))
+		}
+		.f32 {
+			Type(call_float_method_a(env, obj, mid, args))
+		}
+		.f64 {
+			Type(call_double_method_a(env, obj, mid, args))
+		}
+		.string {
+			Type(call_string_method_a(env, obj, mid, args))
+		}
+		.object {
+			Type(call_object_method_a(env, obj, mid, args))
+		}
+		.void {
+			call_void_method_a(env, obj, mid, args)
+			Type(Void(false))
 		}
 	}
-	return call_result
 }
 
 fn get_class_static_method_id(env &Env, fqn_sig string) (JavaClass, JavaMethodID) {
 	clazz, fn_name, fn_sig := v2j_signature(fqn_sig)
 
-	mut jclazz := JavaClass(unsafe { nil })
-	// Find the Java class
-	$if android {
-		jclazz = find_class(default_env(), clazz)
-	} $else {
-		jclazz = find_class(env, clazz)
+	// The class is a global reference owned by the class registry
+	jclazz := class_ref(env, clazz)
+	if isnil(jclazz) {
+		return jclazz, JavaMethodID(unsafe { nil })
 	}
-	mid := get_static_method_id(env, jclazz, fn_name, fn_sig)
+	// Failures are left pending for the caller (see `check_method` and `try_call_static_method`)
+	mid := C.GetStaticMethodID(env, jclazz, fn_name.str, fn_sig.str)
 	return jclazz, mid
 }
 
@@ -308,8 +698,8 @@ fn get_object_class_and_method_id(env &Env, obj JavaObject, fqn_sig string) (Jav
 	_, f_name, f_sig := v2j_signature(fqn_sig)
 	// Find the class of the object
 	jclazz := get_object_class(env, obj)
-	// Find the method on the class
-	mid := get_method_id(env, jclazz, f_name, f_sig)
+	// Find the method on the class, failures are left pending for the caller
+	mid := C.GetMethodID(env, jclazz, f_name.str, f_sig.str)
 	return jclazz, mid
 }
 
@@ -328,13 +718,11 @@ pub fn (jo JavaObject) class_name(env &Env) string {
 	return call_string_method_a(env, cls_obj, mid, void_arg.data) // NOTE vfmt will cause a compile error here if you only use 'void_arg.data'
 }
 
+// call calls the static or object method described by `signature` on the class of `jo`.
+// See also `jni.object()` for keeping the class binding around.
 @[inline]
 pub fn (jo JavaObject) call(env &Env, typ MethodType, signature string, args ...Type) CallResult {
-	pkg := jo.class_name(env)
-	return match typ {
-		.@static { call_static_method(env, pkg + '.' + signature, ...args) }
-		.object { call_object_method(env, jo, pkg + '.' + signature, ...args) }
-	}
+	return object(env, jo).call(typ, signature, ...args)
 }
 
 @[inline]
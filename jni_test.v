@@ -0,0 +1,26 @@
+module jni
+
+fn test_sig_typed_objects() {
+	null := JavaObject(unsafe { nil })
+	assert sig('io.vlang.V', 'pass_instance', 'void', typed_object(null, 'io.vlang.V')) == 'io.vlang.V.passInstance(io.vlang.V)'
+	// Array descriptors are passed through
+	assert sig('io.vlang.V', 'sum_ints', int(0), typed_object(null, '[I')) == 'io.vlang.V.sumInts([I) int'
+	assert sig('io.vlang.V', 'join', '', typed_object(null, '[Ljava.lang.String;'), true) == 'io.vlang.V.join([Ljava/lang/String;, bool) string'
+}
+
+fn test_split_signature() {
+	class, name := split_signature('io.vlang.V.getInt() int')
+	assert class == 'io.vlang.V'
+	assert name == 'getInt'
+	class2, name2 := split_signature('io/vlang/V.mixedArguments(bool, int) int')
+	assert class2 == 'io/vlang/V'
+	assert name2 == 'mixedArguments'
+	// Object method signatures have no class
+	class3, name3 := split_signature('toString() string')
+	assert class3 == ''
+	assert name3 == 'toString'
+	// Dots in the argument types are not class separators
+	class4, name4 := split_signature('passInstance(io.vlang.V)')
+	assert class4 == ''
+	assert name4 == 'passInstance'
+}
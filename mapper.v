@@ -0,0 +1,321 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import sync
+
+// Struct <-> Java object mapping.
+//
+// The fields of a V struct are mapped, at compile time, to the Java fields of the same name.
+// The field IDs are resolved once per struct type and Java class and cached, after that copying
+// an object is one class check plus one typed `Get<Type>Field`/`Set<Type>Field` call per field.
+//
+// Field attributes:
+// `@[java: 'name']`             the name of the Java field, if it differs from the V field name
+// `@[java_type: 'Lpkg/Class;']` the Java type descriptor of a `JavaObject` field (default `Ljava/lang/Object;`)
+//
+// Example:
+// ```v
+// struct Reading {
+//	id      int
+//	value   f64
+//	label   string
+//	sampled bool   @[java: 'isSampled']
+// }
+//
+// r := jni.from_java[Reading](env, obj)
+// jni.to_java(env, obj, Reading{ ...r, value: r.value * 2 })
+//
+// struct Context {
+//	input_method_service string @[java: 'INPUT_METHOD_SERVICE']
+// }
+//
+// ctx := jni.static_from_java[Context](env, 'android.content.Context')
+// ```
+
+// FieldMap is the resolved Java fields of a V struct type on one Java class, in struct field order.
+struct FieldMap {
+	class JavaClass // global ref
+	ids   []JavaFieldID
+}
+
+// FieldMaps maps V struct type names to the field maps of the Java classes the struct was used with.
+struct FieldMaps {
+mut:
+	mutex &sync.RwMutex = sync.new_rwmutex()
+	maps  map[string][]&FieldMap
+}
+
+fn field_maps() &FieldMaps {
+	mut fm := unsafe { &FieldMaps(state(.field_maps)) }
+	if isnil(fm) {
+		fm = unsafe { &FieldMaps(set_state_once(.field_maps, &FieldMaps{})) }
+	}
+	return fm
+}
+
+// clear_field_maps deletes all cached field maps.
+pub fn clear_field_maps(env &Env) {
+	mut fm := field_maps()
+	fm.mutex.@lock()
+	for _, maps in fm.maps {
+		for m in maps {
+			delete_global_ref(env, JavaObject(m.class))
+		}
+	}
+	fm.maps.clear()
+	fm.mutex.unlock()
+}
+
+// java_field_name returns the Java name of a struct field from its `java` attribute, or `name`.
+fn java_field_name(name string, attrs []string) string {
+	for attr in attrs {
+		if attr.starts_with('java:') {
+			return attr.all_after(':').trim_space().trim('\'"')
+		}
+	}
+	return name
+}
+
+// java_object_type returns the `java_type` attribute of a `JavaObject` struct field.
+fn java_object_type(attrs []string) string {
+	for attr in attrs {
+		if attr.starts_with('java_type:') {
+			return attr.all_after(':').trim_space().trim('\'"')
+		}
+	}
+	return 'Ljava/lang/Object;'
+}
+
+// matches returns `true` if the field IDs of `m` are valid for the static fields of `class`,
+// or for the fields of `obj` if `class` is `nil`.
+@[inline]
+fn (m &FieldMap) matches(env &Env, obj JavaObject, class JavaClass) bool {
+	if isnil(class) {
+		// Field IDs of a class are valid for instances of its subclasses too
+		return is_instance_of(env, obj, m.class)
+	}
+	return is_same_object(env, JavaObject(m.class), JavaObject(class))
+}
+
+// field_map returns the cached field map of `T` for `class`, or for the class of `obj` if `class` is `nil`.
+// On first use with a class the field IDs are resolved on it.
+fn field_map[T](env &Env, obj JavaObject, class JavaClass, is_static bool) &FieldMap {
+	key := if is_static { 'static ' + typeof[T]().name } else { typeof[T]().name }
+	mut fm := field_maps()
+	fm.mutex.@rlock()
+	cached := fm.maps[key] or { []&FieldMap{} }
+	fm.mutex.runlock()
+	// Entries are only appended, so the snapshot can be checked without holding the lock
+	for m in cached {
+		if m.matches(env, obj, class) {
+			return m
+		}
+	}
+
+	local := if isnil(class) { get_object_class(env, obj) } else { class }
+	mut ids := []JavaFieldID{}
+	$for field in T.fields {
+		name := java_field_name(field.name, field.attrs)
+		mut desc := ''
+		$if field.typ is bool {
+			desc = 'Z'
+		} $else $if field.typ is u8 {
+			desc = 'B'
+		} $else $if field.typ is rune {
+			desc = 'C'
+		} $else $if field.typ is i16 {
+			desc = 'S'
+		} $else $if field.typ is int {
+			desc = 'I'
+		} $else $if field.typ is i64 {
+			desc = 'J'
+		} $else $if field.typ is f32 {
+			desc = 'F'
+		} $else $if field.typ is f64 {
+			desc = 'D'
+		} $else $if field.typ is string {
+			desc = 'Ljava/lang/String;'
+		} $else $if field.typ is JavaObject {
+			desc = java_object_type(field.attrs)
+		} $else {
+			$compile_error('jni.field_map: unsupported struct field type')
+		}
+		fid := if is_static {
+			get_static_field_id(env, local, name, desc)
+		} else {
+			get_field_id(env, local, name, desc)
+		}
+		if isnil(fid) {
+			$if debug {
+				exception_describe(env)
+			}
+			exception_clear(env)
+			panic(@MOD + '.' + @FN + ': no field "${name} ${desc}" for `${typeof[T]().name}.${field.name}`')
+		}
+		ids << fid
+	}
+	m := &FieldMap{
+		class: JavaClass(new_global_ref(env, JavaObject(local)))
+		ids:   ids
+	}
+	if isnil(class) {
+		delete_local_ref(env, JavaObject(local))
+	}
+
+	// Threads missing at the same time may both add a map for the class; both are valid
+	// and freed by `clear_field_maps`
+	fm.mutex.@lock()
+	fm.maps[key] << m
+	fm.mutex.unlock()
+	return m
+}
+
+// from_java returns a `T` with its fields copied from the fields of the Java object `obj`.
+// `JavaObject` fields are new local references.
+@[direct_array_access]
+pub fn from_java[T](env &Env, obj JavaObject) T {
+	m := field_map[T](env, obj, JavaClass(unsafe { nil }), false)
+	mut val := T{}
+	mut i := 0
+	$for field in T.fields {
+		fid := m.ids[i]
+		$if field.typ is bool {
+			val.$(field.name) = get_boolean_field(env, obj, fid)
+		} $else $if field.typ is u8 {
+			val.$(field.name) = get_byte_field(env, obj, fid)
+		} $else $if field.typ is rune {
+			val.$(field.name) = get_char_field(env, obj, fid)
+		} $else $if field.typ is i16 {
+			val.$(field.name) = get_short_field(env, obj, fid)
+		} $else $if field.typ is int {
+			val.$(field.name) = get_int_field(env, obj, fid)
+		} $else $if field.typ is i64 {
+			val.$(field.name) = get_long_field(env, obj, fid)
+		} $else $if field.typ is f32 {
+			val.$(field.name) = get_float_field(env, obj, fid)
+		} $else $if field.typ is f64 {
+			val.$(field.name) = get_double_field(env, obj, fid)
+		} $else $if field.typ is string {
+			val.$(field.name) = get_string_field(env, obj, fid)
+		} $else $if field.typ is JavaObject {
+			val.$(field.name) = get_object_field(env, obj, fid)
+		}
+		i++
+	}
+	return val
+}
+
+// to_java copies the fields of `val` to the fields of the Java object `obj`.
+@[direct_array_access]
+pub fn to_java[T](env &Env, obj JavaObject, val T) {
+	m := field_map[T](env, obj, JavaClass(unsafe { nil }), false)
+	mut i := 0
+	$for field in T.fields {
+		fid := m.ids[i]
+		$if field.typ is bool {
+			set_boolean_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is u8 {
+			set_byte_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is rune {
+			set_char_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is i16 {
+			set_short_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is int {
+			set_int_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is i64 {
+			set_long_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is f32 {
+			set_float_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is f64 {
+			set_double_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is string {
+			set_string_field(env, obj, fid, val.$(field.name))
+		} $else $if field.typ is JavaObject {
+			set_object_field(env, obj, fid, val.$(field.name))
+		}
+		i++
+	}
+}
+
+// static_class returns the registered class `class_name` of the static fields to copy.
+// A `nil` class would make `field_map` look up the class of a `nil` object.
+fn static_class(env &Env, class_name string) JavaClass {
+	cls := class_ref(env, class_name)
+	if isnil(cls) {
+		$if debug {
+			exception_describe(env)
+		}
+		exception_clear(env)
+		panic(@MOD + '.' + @FN + ': could not find class "${class_name}"')
+	}
+	return cls
+}
+
+// static_from_java returns a `T` with its fields copied from the static fields of the class `class_name`.
+@[direct_array_access]
+pub fn static_from_java[T](env &Env, class_name string) T {
+	m := field_map[T](env, JavaObject(unsafe { nil }), static_class(env, class_name), true)
+	mut val := T{}
+	mut i := 0
+	$for field in T.fields {
+		fid := m.ids[i]
+		$if field.typ is bool {
+			val.$(field.name) = get_static_boolean_field(env, m.class, fid)
+		} $else $if field.typ is u8 {
+			val.$(field.name) = get_static_byte_field(env, m.class, fid)
+		} $else $if field.typ is rune {
+			val.$(field.name) = get_static_char_field(env, m.class, fid)
+		} $else $if field.typ is i16 {
+			val.$(field.name) = get_static_short_field(env, m.class, fid)
+		} $else $if field.typ is int {
+			val.$(field.name) = get_static_int_field(env, m.class, fid)
+		} $else $if field.typ is i64 {
+			val.$(field.name) = get_static_long_field(env, m.class, fid)
+		} $else $if field.typ is f32 {
+			val.$(field.name) = get_static_float_field(env, m.class, fid)
+		} $else $if field.typ is f64 {
+			val.$(field.name) = get_static_double_field(env, m.class, fid)
+		} $else $if field.typ is string {
+			val.$(field.name) = get_static_string_field(env, m.class, fid)
+		} $else $if field.typ is JavaObject {
+			val.$(field.name) = get_static_object_field(env, m.class, fid)
+		}
+		i++
+	}
+	return val
+}
+
+// static_to_java copies the fields of `val` to the static fields of the class `class_name`.
+@[direct_array_access]
+pub fn static_to_java[T](env &Env, class_name string, val T) {
+	m := field_map[T](env, JavaObject(unsafe { nil }), static_class(env, class_name), true)
+	mut i := 0
+	$for field in T.fields {
+		fid := m.ids[i]
+		$if field.typ is bool {
+			set_static_boolean_field(env, m.class, fid, val.$(field.name))
+		} $else $if field.typ is u8 {
+			set_static_byte_field(env, m.class, fid, val.$(field.name))
+		} $else $if field.typ is rune {
+			set_static_char_field(env, m.class, fid, val.$(field.name))
+		} $else $if field.typ is i16 {
+			set_static_short_field(env, m.class, fid, val.$(field.name))
+		} $else $if field.typ is int {
+			set_static_int_field(env, m.class, fid, val.$(field.name))
+		} $else $if field.typ is i64 {
+			set_static_long_field(env, m.class, fid, val.$(field.name))
+		} $else $if field.typ is f32 {
+			set_static_float_field(env, m.class, fid, val.$(field.name))
+		} $else $if field.typ is f64 {
+			set_static_double_field(env, m.class, fid, val.$(field.name))
+		} $else $if field.typ is string {
+			jstr := jstring(env, val.$(field.name))
+			set_static_object_field(env, m.class, fid, JavaObject(jstr))
+			delete_local_ref(env, JavaObject(jstr))
+		} $else $if field.typ is JavaObject {
+			set_static_object_field(env, m.class, fid, val.$(field.name))
+		}
+		i++
+	}
+}
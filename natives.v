@@ -0,0 +1,93 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+// Native method registration.
+//
+// Instead of exporting `Java_<class>_<method>` symbols and letting the JavaVM look them up
+// on first call, native methods can be bound explicitly, one `RegisterNatives` call per class,
+// typically from `JNI_OnLoad`. The V functions do not need a `Java_` symbol but, like exported
+// native methods, must use the JNI calling convention (`JNICALL`, it matters on 32-bit Windows).
+//
+// Example:
+// ```v
+// @[export: 'JNICALL v_add_int']
+// fn add_v_int(env &jni.Env, thiz jni.JavaObject, a int, b int) int {
+//	return a + b
+// }
+//
+// @[export: 'JNI_OnLoad']
+// fn jni_on_load(vm &jni.JavaVM, reserved voidptr) int {
+//	jni.set_java_vm(vm)
+//	jni.register_native_methods(jni.default_env(), [
+//		jni.native('io.vlang.V', 'vAddInt(int, int) int', add_v_int),
+//	]) or { return -1 }
+//	return int(jni.Version.v1_6)
+// }
+// ```
+
+// NativeMethod binds the V function at `fn_ptr` to the native Java method `name`
+// with the Java method descriptor `descriptor` on `class`.
+pub struct NativeMethod {
+pub:
+	class      string // e.g. 'io.vlang.V'
+	name       string // e.g. 'vAddInt'
+	descriptor string // e.g. '(II)I'
+	fn_ptr     voidptr
+}
+
+// native returns a `NativeMethod` for the V function `f` implementing the Java method
+// described by the `jni` style `signature`, e.g. 'vAddInt(int, int) int' (see `v2j_descriptor`).
+// Arguments of a specific class are given by their fully qualified name, e.g. 'io.vlang.V'.
+// The parameters of `f` are the `Env`, the receiver (`JavaObject`, or `JavaClass` for static
+// methods) and the Java arguments, in that order.
+pub fn native[F](class string, signature string, f F) NativeMethod {
+	name, _ := parse_signature(signature)
+	desc, _, _ := v2j_descriptor(signature)
+	return NativeMethod{
+		class:      class
+		name:       name
+		descriptor: desc
+		fn_ptr:     voidptr(f)
+	}
+}
+
+// register_native_methods registers `methods` with one `RegisterNatives` call per class
+// and returns the number of methods registered.
+pub fn register_native_methods(env &Env, methods []NativeMethod) !int {
+	mut classes := []string{}
+	mut by_class := map[string][]NativeMethod{}
+	for m in methods {
+		if m.class !in by_class {
+			classes << m.class
+		}
+		by_class[m.class] << m
+	}
+	mut registered := 0
+	for class in classes {
+		group := by_class[class]
+		cls := class_ref(env, class)
+		if isnil(cls) {
+			exception_describe(env)
+			exception_clear(env)
+			return error(@MOD + '.' + @FN + ': could not find class "${class}"')
+		}
+		mut names := []&char{cap: group.len}
+		mut descriptors := []&char{cap: group.len}
+		mut fns := []voidptr{cap: group.len}
+		for m in group {
+			names << &char(m.name.str)
+			descriptors << &char(m.descriptor.str)
+			fns << m.fn_ptr
+		}
+		status := C.gRegisterNatives(env, cls, names.data, descriptors.data, fns.data, group.len)
+		if status != 0 {
+			// The pending exception is the only description of what did not match
+			exception_describe(env)
+			exception_clear(env)
+			return error(@MOD + '.' + @FN + ': could not register native methods ${group.map(it.name + it.descriptor)} on "${class}"')
+		}
+		registered += group.len
+	}
+	return registered
+}
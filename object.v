@@ -1,9 +1,109 @@
 module jni
 
+import sync
+import sync.stdatomic
+
+// Object is a Java object bound to its class.
+// Method and field IDs are resolved on first use and kept in a `ClassBinding`
+// shared by all `Object`s of the same class, so a long-lived wrapper gets
+// cheaper the more it is used.
 pub struct Object {
-	env &Env
-	obj JavaObject
-	pkg string
+	env     &Env
+	obj     JavaObject
+	pkg     string // the Java name of the class, e.g. 'io.vlang.V' or '[I'
+	binding &ClassBinding
+}
+
+// ClassBinding is a Java class (global ref) with its resolved method and field IDs.
+pub struct ClassBinding {
+pub:
+	name  string // e.g. 'io.vlang.V'
+	class JavaClass
+mut:
+	generation u64 // see `ClassBindings.generation`
+	mutex      &sync.RwMutex = sync.new_rwmutex()
+	methods    map[string][]BoundMethod // one entry per argument descriptor, see `MethodCache`
+	fields     map[string]BoundField
+}
+
+struct BoundMethod {
+	mid     JavaMethodID
+	ret     ValueKind
+	args    string      // the argument descriptor the method was resolved with
+	classes []JavaClass // global refs, see `args_descriptor`
+}
+
+struct BoundField {
+	fid  JavaFieldID
+	kind ValueKind
+}
+
+// ClassBindings maps class names to the bindings of the classes with that name,
+// one per class loader that loaded a class of that name.
+// Binding lists are replaced, never changed in place, so lookups compare classes
+// on a snapshot without holding the lock.
+struct ClassBindings {
+mut:
+	mutex      &sync.RwMutex = sync.new_rwmutex()
+	bindings   map[string][]&ClassBinding
+	generation u64 // bumped by `clear_class_bindings`, outdating all bindings made before
+}
+
+fn class_bindings() &ClassBindings {
+	mut cb := unsafe { &ClassBindings(state(.class_bindings)) }
+	if isnil(cb) {
+		cb = unsafe { &ClassBindings(set_state_once(.class_bindings, &ClassBindings{})) }
+	}
+	return cb
+}
+
+// class_binding returns the shared binding of the class `cls` named `name`.
+fn class_binding(env &Env, name string, cls JavaClass) &ClassBinding {
+	mut cb := class_bindings()
+	cb.mutex.@rlock()
+	cached := cb.bindings[name] or { []&ClassBinding{} }
+	cb.mutex.runlock()
+	for binding in cached {
+		if is_same_object(env, JavaObject(binding.class), JavaObject(cls)) {
+			return binding
+		}
+	}
+
+	mut binding := &ClassBinding{
+		name:  name
+		class: JavaClass(new_global_ref(env, JavaObject(cls)))
+	}
+	// Threads binding the same class at the same time may each add a binding;
+	// they are equivalent and all released by `clear_class_bindings`
+	cb.mutex.@lock()
+	binding.generation = cb.generation
+	current := cb.bindings[name] or { []&ClassBinding{} }
+	mut grown := []&ClassBinding{cap: current.len + 1}
+	grown << current
+	grown << binding
+	cb.bindings[name] = grown
+	cb.mutex.unlock()
+	return binding
+}
+
+// clear_class_bindings deletes the global class references of all class bindings.
+// `Object`s made before are bound again on their next use.
+pub fn clear_class_bindings(env &Env) {
+	mut cb := class_bindings()
+	cb.mutex.@lock()
+	for _, bindings in cb.bindings {
+		for binding in bindings {
+			for _, methods in binding.methods {
+				for m in methods {
+					release_arg_classes(env, m.classes)
+				}
+			}
+			delete_global_ref(env, JavaObject(binding.class))
+		}
+	}
+	cb.bindings.clear()
+	stdatomic.add_u64(&cb.generation, 1)
+	cb.mutex.unlock()
 }
 
 /*
@@ -13,22 +113,237 @@ pub fn (o Object) call_static(signature string, args ...Type) CallResult {
 }
 */
 pub fn object(env &Env, obj JavaObject) Object {
-	p := obj.class_name(env)
+	cls := get_object_class(env, obj)
+	desc := class_descriptor(env, cls)
+	// Java names array classes by their descriptor, e.g. '[I' or '[Ljava.lang.String;'
+	p := if desc.starts_with('[') {
+		desc.replace('/', '.')
+	} else {
+		desc[1..desc.len - 1].replace('/', '.')
+	}
+	binding := class_binding(env, p, cls)
+	delete_local_ref(env, JavaObject(cls))
 	unsafe {
 		return Object{
-			env: env
-			obj: obj
-			pkg: p
+			env:     env
+			obj:     obj
+			pkg:     p
+			binding: binding
 		}
 	}
 }
 
+// live_binding returns the binding of `o`, binding it again if the bindings were cleared
+// after `o` was made.
+@[inline]
+fn (o &Object) live_binding() &ClassBinding {
+	mut cb := class_bindings()
+	if o.binding.generation == stdatomic.load_u64(&cb.generation) {
+		return o.binding
+	}
+	cls := get_object_class(o.env, o.obj)
+	binding := class_binding(o.env, o.pkg, cls)
+	delete_local_ref(o.env, JavaObject(cls))
+	return binding
+}
+
+// method returns the method described by the V `jni` style `signature` (without class name)
+// for the types of `args`, resolving it on first use.
+fn (mut b ClassBinding) method(env &Env, typ MethodType, signature string, args []Type) BoundMethod {
+	key := if typ == .@static { 'static ' + signature } else { signature }
+	b.mutex.@rlock()
+	cached := b.methods[key] or { []BoundMethod{} }
+	b.mutex.runlock()
+	for m in cached {
+		if args_match(env, m.args, m.classes, args) {
+			return m
+		}
+	}
+
+	name, return_type := parse_signature(signature)
+	jargs, classes := args_descriptor(env, args)
+	desc := '(' + jargs + ')' + v2j_string_signature_type(return_type)
+	m := BoundMethod{
+		mid:     if typ == .@static {
+			C.GetStaticMethodID(env, b.class, name.str, desc.str)
+		} else {
+			C.GetMethodID(env, b.class, name.str, desc.str)
+		}
+		ret:     value_kind(return_type)
+		args:    jargs
+		classes: classes
+	}
+	if isnil(m.mid) {
+		// Not cached, the exception is pending for the caller
+		release_arg_classes(env, classes)
+		return m
+	}
+	b.mutex.@lock()
+	defer {
+		b.mutex.unlock()
+	}
+	current := b.methods[key] or { []BoundMethod{} }
+	for existing in current {
+		if existing.args == jargs {
+			release_arg_classes(env, classes)
+			return existing
+		}
+	}
+	mut grown := []BoundMethod{cap: current.len + 1}
+	grown << current
+	grown << m
+	b.methods[key] = grown
+	return m
+}
+
+// field returns the field described by `field` in the form '<name> <V type>', e.g. 'm_int_test int',
+// resolving it on first use.
+fn (mut b ClassBinding) field(env &Env, typ MethodType, field string) BoundField {
+	key := if typ == .@static { 'static ' + field } else { field }
+	b.mutex.@rlock()
+	if f := b.fields[key] {
+		b.mutex.runlock()
+		return f
+	}
+	b.mutex.runlock()
+
+	name := field.all_before(' ').trim_space()
+	v_type := field.all_after(' ').trim_space()
+	desc := v2j_string_signature_type(v_type)
+	f := BoundField{
+		fid:  if typ == .@static {
+			get_static_field_id(env, b.class, name, desc)
+		} else {
+			get_field_id(env, b.class, name, desc)
+		}
+		kind: value_kind(v_type)
+	}
+	if isnil(f.fid) {
+		// Never cached, a nil ID would reach Get/Set<Type>Field
+		check_field(env, f.fid, b.name + '.' + field)
+	}
+	b.mutex.@lock()
+	b.fields[key] = f
+	b.mutex.unlock()
+	return f
+}
+
+// call calls the static or object method described by `signature`, e.g. 'setInt(int)'.
 @[inline]
 pub fn (o Object) call(typ MethodType, signature string, args ...Type) CallResult {
-	return o.obj.call(o.env, typ, signature, ...args)
-	/*
-	return match typ {
-		.@static { call_static_method(o.env, o.pkg + '.' + signature, ...args) }
-		.object { call_object_method(o.env, o.obj, o.pkg + '.' + signature, ...args) }
-	}*/
+	$if debug {
+		check_not_critical(@FN)
+	}
+	start := stats_now()
+	mut b := unsafe { o.live_binding() }
+	m := b.method(o.env, typ, signature, args)
+	if isnil(m.mid) {
+		check_method(o.env, m.mid, o.pkg + '.' + signature)
+	}
+	frame := needs_local_frame(m.ret, args)
+	if frame {
+		local_frame(o.env, args.len + 1)
+	}
+	mut jv_args := []JavaValue{cap: args.len}
+	for vt in args {
+		jv_args << v2j_value(o.env, vt)
+	}
+	mut result := match typ {
+		.@static { static_result(o.env, b.class, m.mid, m.ret, jv_args.data) }
+		.object { object_result(o.env, o.obj, m.mid, m.ret, jv_args.data) }
+	}
+	if frame {
+		result = pop_frame_result(o.env, result)
+	}
+	$if jni_stats ? {
+		stats_call(o.pkg + '.' + signature, start)
+	}
+	$if debug {
+		if exception_check(o.env) {
+			exception_describe(o.env)
+			panic(@MOD + '.' + @FN +
+				' an exception occured while executing "${o.pkg}.${signature}" in JNIEnv (${ptr_str(o.env)})')
+		}
+	}
+	$if trace_calls ? {
+		return call_result(o.pkg + '.' + signature, result)
+	}
+	return call_result(signature, result)
+}
+
+// get returns the value of the static or object field described by `field`, e.g. 'm_int_test int'.
+pub fn (o Object) get(typ MethodType, field string) Type {
+	mut b := unsafe { o.live_binding() }
+	f := b.field(o.env, typ, field)
+	env := o.env
+	if typ == .@static {
+		return match f.kind {
+			.bool { Type(get_static_boolean_field(env, b.class, f.fid)) }
+			.u8 { Type(get_static_byte_field(env, b.class, f.fid)) }
+			.rune { Type(get_static_char_field(env, b.class, f.fid)) }
+			.i16 { Type(get_static_short_field(env, b.class, f.fid)) }
+			.int { Type(get_static_int_field(env, b.class, f.fid)) }
+			.i64 { Type(get_static_long_field(env, b.class, f.fid)) }
+			.f32 { Type(get_static_float_field(env, b.class, f.fid)) }
+			.f64 { Type(get_static_double_field(env, b.class, f.fid)) }
+			.string { Type(get_static_string_field(env, b.class, f.fid)) }
+			.object { Type(get_static_object_field(env, b.class, f.fid)) }
+			.void { Type(Void(false)) }
+		}
+	}
+	return match f.kind {
+		.bool { Type(get_boolean_field(env, o.obj, f.fid)) }
+		.u8 { Type(get_byte_field(env, o.obj, f.fid)) }
+		.rune { Type(get_char_field(env, o.obj, f.fid)) }
+		.i16 { Type(get_short_field(env, o.obj, f.fid)) }
+		.int { Type(get_int_field(env, o.obj, f.fid)) }
+		.i64 { Type(get_long_field(env, o.obj, f.fid)) }
+		.f32 { Type(get_float_field(env, o.obj, f.fid)) }
+		.f64 { Type(get_double_field(env, o.obj, f.fid)) }
+		.string { Type(get_string_field(env, o.obj, f.fid)) }
+		.object { Type(get_object_field(env, o.obj, f.fid)) }
+		.void { Type(Void(false)) }
+	}
+}
+
+// set sets the static or object field described by `field`, e.g. 'm_int_test int', to `val`.
+pub fn (o Object) set(typ MethodType, field string, val Type) {
+	mut b := unsafe { o.live_binding() }
+	f := b.field(o.env, typ, field)
+	env := o.env
+	if typ == .@static {
+		match val {
+			bool { set_static_boolean_field(env, b.class, f.fid, val) }
+			u8 { set_static_byte_field(env, b.class, f.fid, val) }
+			rune { set_static_char_field(env, b.class, f.fid, val) }
+			i16 { set_static_short_field(env, b.class, f.fid, val) }
+			int { set_static_int_field(env, b.class, f.fid, val) }
+			i64 { set_static_long_field(env, b.class, f.fid, val) }
+			f32 { set_static_float_field(env, b.class, f.fid, val) }
+			f64 { set_static_double_field(env, b.class, f.fid, val) }
+			string {
+				jstr := jstring(env, val)
+				set_static_object_field(env, b.class, f.fid, JavaObject(jstr))
+				delete_local_ref(env, JavaObject(jstr))
+			}
+			JavaObject { set_static_object_field(env, b.class, f.fid, val) }
+			TypedObject { set_static_object_field(env, b.class, f.fid, val.obj) }
+			Void {}
+		}
+		return
+	}
+	match val {
+		bool { set_boolean_field(env, o.obj, f.fid, val) }
+		u8 { set_byte_field(env, o.obj, f.fid, val) }
+		rune { set_char_field(env, o.obj, f.fid, val) }
+		i16 { set_short_field(env, o.obj, f.fid, val) }
+		int { set_int_field(env, o.obj, f.fid, val) }
+		i64 { set_long_field(env, o.obj, f.fid, val) }
+		f32 { set_float_field(env, o.obj, f.fid, val) }
+		f64 { set_double_field(env, o.obj, f.fid, val) }
+		string { set_string_field(env, o.obj, f.fid, val) }
+		JavaObject { set_object_field(env, o.obj, f.fid, val) }
+		TypedObject { set_object_field(env, o.obj, f.fid, val.obj) }
+		Void {}
+	}
 }
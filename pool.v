@@ -0,0 +1,190 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import sync
+import sync.stdatomic
+
+// WorkerPool is a fixed set of threads attached to the JavaVM once, at startup,
+// that run tasks calling into Java in parallel.
+// Each worker has its own task queue; idle workers steal from the others.
+// Every task runs in its own local reference frame.
+//
+// Example:
+// ```v
+// mut pool := jni.new_worker_pool(4)
+// mut futures := []jni.Future[string]{}
+// for doc in docs {
+//	futures << pool.submit[string](fn [doc] (env &jni.Env) string {
+//		return jni.call_static_method(env, 'io.vlang.Parser.parse(string) string', doc).result as string
+//	})
+// }
+// for f in futures {
+//	println(f.wait() or { 'failed: ${err}' })
+// }
+// pool.close()
+// ```
+@[heap]
+pub struct WorkerPool {
+pub:
+	size int
+mut:
+	queues  []&TaskQueue
+	pending &sync.Semaphore = sync.new_semaphore()
+	next    u64
+	closing u64 // 1 once `close` was called, read by the workers with atomic loads
+	workers []thread
+}
+
+type Task = fn (env &Env)
+
+struct TaskQueue {
+mut:
+	mutex &sync.Mutex = sync.new_mutex()
+	tasks []Task
+}
+
+// Future is the result of a task submitted to a `WorkerPool`.
+pub struct Future[T] {
+	state &FutureState[T]
+}
+
+@[heap]
+struct FutureState[T] {
+mut:
+	done   &sync.Semaphore = sync.new_semaphore()
+	value  T
+	failed bool
+	err    IError = none
+}
+
+// wait blocks until the task has run and returns its result, or the Java exception it threw as an error.
+// Object results are *global* references that must be deleted by the caller.
+pub fn (f Future[T]) wait() !T {
+	mut s := unsafe { f.state }
+	s.done.wait()
+	// Let other waiters through too
+	s.done.post()
+	if s.failed {
+		return s.err
+	}
+	return s.value
+}
+
+// new_worker_pool starts `size` worker threads, attached to the JavaVM as "V worker <n>".
+pub fn new_worker_pool(size int) &WorkerPool {
+	if size <= 0 {
+		panic(@MOD + '.' + @FN + ': invalid pool size ${size}')
+	}
+	mut p := &WorkerPool{
+		size: size
+	}
+	for _ in 0 .. size {
+		p.queues << &TaskQueue{}
+	}
+	for i in 0 .. size {
+		p.workers << spawn p.work(i)
+	}
+	return p
+}
+
+// submit queues `f` to run on one of the pool's threads and returns a `Future` of its result.
+// If `f` leaves a Java exception pending it is cleared and returned as the error of the future,
+// see `take_exception`. A `JavaException` error must be freed by the caller; its class name and
+// message are only read, with `JavaException.describe`, if the caller asks for them.
+pub fn (mut p WorkerPool) submit[T](f fn (env &Env) T) Future[T] {
+	state := &FutureState[T]{}
+	p.push(fn [state, f] (env &Env) {
+		mut s := unsafe { state }
+		mut frame := local_frame(env, 16)
+		value := f(env)
+		if exception_check(env) {
+			s.err = take_exception(env, @MOD + '.WorkerPool task')
+			s.failed = true
+		} else {
+			$if T is JavaObject {
+				// Local references are only valid on the thread that created them
+				s.value = new_global_ref(env, value)
+			} $else {
+				s.value = value
+			}
+		}
+		frame.pop(JavaObject(unsafe { nil }))
+		s.done.post()
+	})
+	return Future[T]{
+		state: state
+	}
+}
+
+fn (mut p WorkerPool) push(task Task) {
+	if stdatomic.load_u64(&p.closing) != 0 {
+		panic(@MOD + '.' + @FN + ': the worker pool is closed')
+	}
+	index := int(stdatomic.add_u64(&p.next, 1) % u64(p.size))
+	mut q := p.queues[index]
+	q.mutex.@lock()
+	q.tasks << task
+	q.mutex.unlock()
+	p.pending.post()
+}
+
+// take returns the next task for worker `index`: the newest from its own queue,
+// or the oldest of another worker's queue.
+fn (mut p WorkerPool) take(index int) ?Task {
+	mut own := p.queues[index]
+	own.mutex.@lock()
+	if own.tasks.len > 0 {
+		task := own.tasks.pop()
+		own.mutex.unlock()
+		return task
+	}
+	own.mutex.unlock()
+	for i in 1 .. p.size {
+		mut q := p.queues[(index + i) % p.size]
+		q.mutex.@lock()
+		if q.tasks.len > 0 {
+			task := q.tasks[0]
+			q.tasks.delete(0)
+			q.mutex.unlock()
+			return task
+		}
+		q.mutex.unlock()
+	}
+	return none
+}
+
+fn (mut p WorkerPool) work(index int) {
+	env := attach_current_thread('V worker ${index}')
+	for {
+		p.pending.wait()
+		task := p.next_task(index) or { break }
+		task(env)
+	}
+	detach_current_thread()
+}
+
+// next_task returns the task the post worker `index` woke up for, or none once the pool is closing.
+// Every post other than the wake up calls from `close` is for a queued task, but another worker
+// may take it while the task that worker woke up for is still being queued; `take` is called
+// again until a task turns up, so the post is not lost.
+fn (mut p WorkerPool) next_task(index int) ?Task {
+	for stdatomic.load_u64(&p.closing) == 0 {
+		if task := p.take(index) {
+			return task
+		}
+	}
+	return p.take(index)
+}
+
+// close waits for all submitted tasks to finish and stops the worker threads.
+pub fn (mut p WorkerPool) close() {
+	if stdatomic.load_u64(&p.closing) != 0 {
+		return
+	}
+	stdatomic.store_u64(&p.closing, 1)
+	for _ in 0 .. p.size {
+		p.pending.post()
+	}
+	p.workers.wait()
+}
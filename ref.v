@@ -0,0 +1,269 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import sync
+
+// Owned references.
+//
+// `GlobalRef[T]` and `WeakRef[T]` own a global or weak global reference to a Java object
+// of the reference type `T` (`JavaObject`, `JavaClass`, `JavaString`, ...) and delete it
+// with `free`. Both can be kept across JNI calls and used from any thread.
+//
+// In debug builds every reference is recorded with the allocation site passed in `site`,
+// `live_refs` lists the ones not freed yet and `on_unload` reports them as leaks.
+//
+// Example:
+// ```v
+// struct App {
+// mut:
+//	activity jni.GlobalRef[jni.JavaObject]
+//	listener jni.WeakRef[jni.JavaObject]
+// }
+//
+// app.activity = jni.global_ref(env, activity, site: @LOCATION)
+// app.listener = jni.weak_ref(env, listener, site: @LOCATION)
+// ...
+// if l := app.listener.upgrade(env) {
+//	jni.call_object_method_void(env, l, 'onEvent(int)', 1)
+//	jni.delete_local_ref(env, l)
+// }
+// app.activity.free(env)
+// app.listener.free(env)
+// ```
+
+@[params]
+pub struct RefOptions {
+pub:
+	site string // allocation site reported for leaks, e.g. `@LOCATION`
+}
+
+// GlobalRef owns a global reference to a Java object.
+pub struct GlobalRef[T] {
+mut:
+	ref T
+}
+
+// WeakRef owns a weak global reference to a Java object, which does not keep the object alive.
+pub struct WeakRef[T] {
+mut:
+	ref T
+}
+
+// check_ref_type fails to compile if `T` is not a Java reference type.
+@[inline]
+fn check_ref_type[T]() {
+	$if T is JavaObject || T is JavaClass || T is JavaString || T is JavaThrowable
+		|| T is JavaArray || T is JavaByteArray || T is JavaCharArray || T is JavaShortArray
+		|| T is JavaIntArray || T is JavaLongArray || T is JavaFloatArray || T is JavaDoubleArray
+		|| T is JavaObjectArray {
+	} $else {
+		$compile_error('jni: GlobalRef and WeakRef only hold Java reference types')
+	}
+}
+
+// global_ref returns a new global reference to `obj`, which may be a local, global or weak reference.
+// A `nil` `obj`, or a weak reference to a collected object, gives a `nil` `GlobalRef`.
+pub fn global_ref[T](env &Env, obj T, opts RefOptions) GlobalRef[T] {
+	check_ref_type[T]()
+	if isnil(obj) {
+		return GlobalRef[T]{}
+	}
+	ref := new_global_ref(env, JavaObject(obj))
+	if isnil(ref) {
+		if !exception_check(env) {
+			// `obj` is a weak reference to a collected object
+			return GlobalRef[T]{}
+		}
+		// An OutOfMemoryError is pending
+		$if debug {
+			exception_describe(env)
+		}
+		panic(@MOD + '.' + @FN + ': could not create a global reference to ${ptr_str(obj)} in jni.Env (${ptr_str(env)})')
+	}
+	$if debug {
+		track_ref(ref, false, opts.site)
+	}
+	return GlobalRef[T]{
+		ref: T(ref)
+	}
+}
+
+// get returns the global reference. It is valid until `free` is called.
+@[inline]
+pub fn (r &GlobalRef[T]) get() T {
+	return r.ref
+}
+
+// is_nil returns `true` if `r` holds no reference.
+@[inline]
+pub fn (r &GlobalRef[T]) is_nil() bool {
+	return isnil(r.ref)
+}
+
+// local returns a new local reference to the object, e.g. to return it from a native method.
+pub fn (r &GlobalRef[T]) local(env &Env) T {
+	return T(new_local_ref(env, JavaObject(r.ref)))
+}
+
+// weak returns a new weak reference to the object.
+pub fn (r &GlobalRef[T]) weak(env &Env, opts RefOptions) WeakRef[T] {
+	return weak_ref[T](env, r.ref, opts)
+}
+
+// free deletes the global reference. Calling `free` more than once is a no-op.
+pub fn (mut r GlobalRef[T]) free(env &Env) {
+	if isnil(r.ref) {
+		return
+	}
+	$if debug {
+		untrack_ref(JavaObject(r.ref))
+	}
+	delete_global_ref(env, JavaObject(r.ref))
+	r.ref = T(unsafe { nil })
+}
+
+// weak_ref returns a new weak global reference to `obj`. A `nil` `obj` gives a `nil` `WeakRef`.
+pub fn weak_ref[T](env &Env, obj T, opts RefOptions) WeakRef[T] {
+	check_ref_type[T]()
+	if isnil(obj) {
+		return WeakRef[T]{}
+	}
+	ref := new_weak_global_ref(env, JavaObject(obj))
+	if isnil(ref) {
+		$if debug {
+			if exception_check(env) {
+				exception_describe(env)
+			}
+		}
+		panic(@MOD + '.' + @FN + ': could not create a weak reference to ${ptr_str(obj)} in jni.Env (${ptr_str(env)})')
+	}
+	$if debug {
+		track_ref(ref, true, opts.site)
+	}
+	return WeakRef[T]{
+		ref: T(ref)
+	}
+}
+
+// upgrade returns a new local reference to the object, or `none` if it has been garbage
+// collected (or `r` is `nil`). The local reference keeps the object alive until it is deleted.
+pub fn (r &WeakRef[T]) upgrade(env &Env) ?T {
+	if isnil(r.ref) {
+		return none
+	}
+	local := new_local_ref(env, JavaObject(r.ref))
+	if isnil(local) {
+		return none
+	}
+	return T(local)
+}
+
+// is_collected returns `true` if the object has been garbage collected.
+// A `false` result can be outdated right away, use `upgrade` to use the object.
+pub fn (r &WeakRef[T]) is_collected(env &Env) bool {
+	return is_same_object(env, JavaObject(r.ref), JavaObject(unsafe { nil }))
+}
+
+// free deletes the weak reference. Calling `free` more than once is a no-op.
+pub fn (mut r WeakRef[T]) free(env &Env) {
+	if isnil(r.ref) {
+		return
+	}
+	$if debug {
+		untrack_ref(JavaObject(r.ref))
+	}
+	delete_weak_global_ref(env, JavaObject(r.ref))
+	r.ref = T(unsafe { nil })
+}
+
+// LiveRefs are the `GlobalRef`s or `WeakRef`s created at one allocation site and not freed yet.
+pub struct LiveRefs {
+pub:
+	site  string
+	weak  bool
+	count int
+}
+
+struct TrackedRef {
+	site string
+	weak bool
+}
+
+// RefRegistry records the references created by `global_ref` and `weak_ref` in debug builds.
+struct RefRegistry {
+mut:
+	mutex &sync.RwMutex = sync.new_rwmutex()
+	refs  map[u64]TrackedRef
+}
+
+fn ref_registry() &RefRegistry {
+	mut rr := unsafe { &RefRegistry(state(.refs)) }
+	if isnil(rr) {
+		rr = unsafe { &RefRegistry(set_state_once(.refs, &RefRegistry{})) }
+	}
+	return rr
+}
+
+fn track_ref(ref JavaObject, weak bool, site string) {
+	mut rr := ref_registry()
+	rr.mutex.@lock()
+	rr.refs[u64(ref)] = TrackedRef{
+		site: if site == '' { 'unknown site' } else { site }
+		weak: weak
+	}
+	rr.mutex.unlock()
+}
+
+fn untrack_ref(ref JavaObject) {
+	mut rr := ref_registry()
+	rr.mutex.@lock()
+	rr.refs.delete(u64(ref))
+	rr.mutex.unlock()
+}
+
+// live_refs returns the `GlobalRef`s and `WeakRef`s not freed yet, grouped by allocation site,
+// most references first. References are only recorded in debug builds.
+pub fn live_refs() []LiveRefs {
+	mut rr := ref_registry()
+	mut globals := map[string]int{}
+	mut weaks := map[string]int{}
+	rr.mutex.@rlock()
+	for _, t in rr.refs {
+		if t.weak {
+			weaks[t.site]++
+		} else {
+			globals[t.site]++
+		}
+	}
+	rr.mutex.runlock()
+	mut res := []LiveRefs{cap: globals.len + weaks.len}
+	for site, count in globals {
+		res << LiveRefs{
+			site:  site
+			count: count
+		}
+	}
+	for site, count in weaks {
+		res << LiveRefs{
+			site:  site
+			weak:  true
+			count: count
+		}
+	}
+	res.sort(a.count > b.count)
+	return res
+}
+
+// report_leaked_refs writes the references not freed yet to stderr and forgets them.
+// Called by `on_unload` in debug builds.
+fn report_leaked_refs() {
+	for l in live_refs() {
+		kind := if l.weak { 'weak' } else { 'global' }
+		eprintln(@MOD + ': leaked ${l.count} ${kind} reference(s) allocated at ${l.site}')
+	}
+	mut rr := ref_registry()
+	rr.mutex.@lock()
+	rr.refs.clear()
+	rr.mutex.unlock()
+}
@@ -0,0 +1,157 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import sync.stdatomic
+
+// EventRing is a single-producer/single-consumer ring buffer of length-prefixed records
+// in a direct `ByteBuffer`, written by V and drained in bulk by the Java class
+// `io.vlang.jni.EventRing` (see java/io/vlang/jni/EventRing.java).
+// Instead of one JNI call per event, V only calls Java (the "doorbell") when the
+// Java consumer has announced that it is idle.
+//
+// Layout (native byte order):
+//
+// offset | size | written by | content
+// -------------------------------------------------------
+// 0      | 8    | V          | head, bytes written in total
+// 64     | 8    | Java       | tail, bytes read in total
+// 72     | 4    | both       | 1 if the consumer is waiting for the doorbell
+// 128    | cap  | V          | records
+//
+// A record is a `u32` length followed by the payload, padded to 8 bytes.
+// A length of `0xFFFFFFFF` marks padding up to the end of the ring.
+//
+// Example:
+// ```v
+// mut ring := jni.new_event_ring(env, 1 << 20)
+// ring.set_doorbell(env, 'io.vlang.App.onEvents() void')
+// jni.call_static_method(env, 'io.vlang.App.setRing(java.nio.ByteBuffer)', ring.buffer.buffer)
+// for sample in samples {
+//	ring.write(sample.bytes())
+// }
+// ring.signal(env)
+// ```
+pub struct EventRing {
+pub:
+	capacity int // bytes available for records, a power of 2
+pub mut:
+	buffer DirectBuffer // mutable so `free` marks it freed in place
+mut:
+	head          u64 // producer position, published to the header by `write`
+	cached_tail   u64
+	doorbell      CallSite
+	has_doorbell  bool
+	pending_bells bool
+	freed         bool
+}
+
+const ring_header_size = 128
+const ring_head_offset = 0
+const ring_tail_offset = 64
+const ring_waiting_offset = 72
+const ring_padding = u32(0xFFFFFFFF)
+
+// new_event_ring returns a new ring with room for `capacity` (a power of 2) bytes of records.
+// The ring's `ByteBuffer` is `ring.buffer.buffer`.
+pub fn new_event_ring(env &Env, capacity int) EventRing {
+	if capacity < 64 || capacity & (capacity - 1) != 0 {
+		panic(@MOD + '.' + @FN + ': capacity ${capacity} is not a power of 2 (>= 64)')
+	}
+	return EventRing{
+		buffer:   new_direct_buffer(env, ring_header_size + capacity, 64)
+		capacity: capacity
+	}
+}
+
+// set_doorbell sets the static `void` Java method, e.g. 'io.vlang.App.onEvents() void',
+// that `signal` calls when the consumer is waiting.
+pub fn (mut r EventRing) set_doorbell(env &Env, signature string) {
+	if r.has_doorbell {
+		r.doorbell.free(env)
+	}
+	r.doorbell = prepare_static_method(env, signature)
+	r.has_doorbell = true
+}
+
+// free releases the doorbell and the ring's buffer (see `DirectBuffer.free`).
+pub fn (mut r EventRing) free(env &Env) {
+	if r.freed {
+		return
+	}
+	r.freed = true
+	if r.has_doorbell {
+		r.doorbell.free(env)
+		r.has_doorbell = false
+	}
+	r.buffer.free(env)
+}
+
+@[inline]
+fn (r &EventRing) word(offset int) &u64 {
+	return unsafe { &u64(&r.buffer.data[offset]) }
+}
+
+@[inline]
+fn (r &EventRing) waiting() &u32 {
+	return unsafe { &u32(&r.buffer.data[ring_waiting_offset]) }
+}
+
+// write appends `record` to the ring and returns `false` if there is no room for it.
+// No JNI calls are made; call `signal` after a batch of writes to wake the consumer.
+@[direct_array_access]
+pub fn (mut r EventRing) write(record []u8) bool {
+	size := u64((4 + record.len + 7) & ~7)
+	capacity := u64(r.capacity)
+	if size > capacity {
+		panic(@MOD + '.' + @FN + ': record of ${record.len} bytes does not fit a ring of ${r.capacity} bytes')
+	}
+	mut pos := r.head & (capacity - 1)
+	contiguous := capacity - pos
+	need := if size <= contiguous { size } else { contiguous + size }
+	if r.head + need - r.cached_tail > capacity {
+		r.cached_tail = stdatomic.load_u64(r.word(ring_tail_offset))
+		if r.head + need - r.cached_tail > capacity {
+			return false
+		}
+	}
+	mut head := r.head
+	unsafe {
+		data := &u8(&r.buffer.data[ring_header_size])
+		if size > contiguous {
+			*(&u32(&data[pos])) = ring_padding
+			head += contiguous
+			pos = 0
+		}
+		*(&u32(&data[pos])) = u32(record.len)
+		if record.len > 0 {
+			vmemcpy(&data[pos + 4], record.data, record.len)
+		}
+	}
+	r.head = head + size
+	// Publish the record(s) to the consumer
+	stdatomic.store_u64(r.word(ring_head_offset), r.head)
+	r.pending_bells = true
+	return true
+}
+
+// signal calls the doorbell if records were written since the last signal and the consumer is waiting.
+pub fn (mut r EventRing) signal(env &Env) {
+	if !r.pending_bells || !r.has_doorbell {
+		return
+	}
+	r.pending_bells = false
+	if stdatomic.load_u32(r.waiting()) == 1 {
+		stdatomic.store_u32(r.waiting(), 0)
+		r.doorbell.call_void(env)
+	}
+}
+
+// push writes `record` and signals the consumer. It returns `false` if there is no room for the record.
+pub fn (mut r EventRing) push(env &Env, record []u8) bool {
+	if !r.write(record) {
+		return false
+	}
+	r.signal(env)
+	return true
+}
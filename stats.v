@@ -0,0 +1,281 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import math.bits
+import strings
+import sync
+import sync.stdatomic
+import time
+
+// JNI crossing statistics.
+//
+// Compiling with `-d jni_stats` records, process-wide:
+// - call counts and latency histograms per signature, for the signature based calls,
+//   `CallSite` calls and the statically typed `call*` functions
+// - method lookups and method cache hits, class lookups and classes loaded
+// - bytes of string and array data copied between V and Java
+// - thread attaches and detaches
+// - the high-water mark of local references created through `jni` on any thread
+//
+// Without `-d jni_stats` nothing is recorded, only the method cache and thread counters are available.
+//
+// Example:
+// ```v
+// jni.reset_stats()
+// handle_request(env, req)
+// eprintln(jni.stats()) // or `jni.dump_stats()`
+// ```
+
+// latency_buckets is the number of buckets in the latency histograms. Bucket 0 counts
+// calls taking less than 64ns, bucket `i` calls taking [2^(i+5), 2^(i+6)) ns,
+// the last bucket everything slower.
+pub const latency_buckets = 24
+
+@[heap]
+struct SignatureCounters {
+mut:
+	calls     u64
+	total_ns  u64
+	max_ns    u64
+	histogram [latency_buckets]u64
+}
+
+struct StatsState {
+mut:
+	mutex         &sync.RwMutex = sync.new_rwmutex()
+	signatures    map[string]&SignatureCounters
+	class_lookups u64
+	class_loads   u64
+	string_bytes  u64
+	array_bytes   u64
+	attach_base   u64
+	detach_base   u64
+}
+
+fn stats_state() &StatsState {
+	mut ss := unsafe { &StatsState(state(.stats)) }
+	if isnil(ss) {
+		ss = unsafe { &StatsState(set_state_once(.stats, &StatsState{})) }
+	}
+	return ss
+}
+
+// SignatureStats are the calls recorded for one signature.
+pub struct SignatureStats {
+pub:
+	signature string
+	calls     u64
+	total_ns  u64
+	max_ns    u64
+	histogram [latency_buckets]u64
+}
+
+// mean returns the mean latency of the calls.
+pub fn (s SignatureStats) mean() time.Duration {
+	if s.calls == 0 {
+		return 0
+	}
+	return time.Duration(i64(s.total_ns / s.calls))
+}
+
+// percentile returns an upper bound of the `p` (0.0 - 1.0) latency percentile, from the histogram.
+pub fn (s SignatureStats) percentile(p f64) time.Duration {
+	if s.calls == 0 {
+		return 0
+	}
+	target := u64(p * f64(s.calls))
+	mut seen := u64(0)
+	for i, count in s.histogram {
+		seen += count
+		if seen > target || seen == s.calls {
+			if i == latency_buckets - 1 {
+				return time.Duration(i64(s.max_ns))
+			}
+			return time.Duration(i64(u64(1) << (i + 6)))
+		}
+	}
+	return time.Duration(i64(s.max_ns))
+}
+
+// Stats is a snapshot of the recorded statistics, see `stats`.
+pub struct Stats {
+pub:
+	enabled               bool             // compiled with `-d jni_stats`
+	signatures            []SignatureStats // most called first
+	method_lookups        u64
+	method_cache_hits     u64
+	class_lookups         u64
+	classes_loaded        u64 // class lookups that went to `FindClass`
+	string_bytes          u64 // bytes of string data converted in either direction
+	array_bytes           u64 // bytes of array elements copied in either direction
+	attaches              u64
+	detaches              u64
+	local_refs_high_water int
+}
+
+// stats returns a snapshot of the statistics recorded since startup or the last `reset_stats`.
+pub fn stats() Stats {
+	mut ss := stats_state()
+	mut sigs := []SignatureStats{}
+	ss.mutex.@rlock()
+	for sig, c in ss.signatures {
+		mut histogram := [latency_buckets]u64{}
+		for i in 0 .. latency_buckets {
+			histogram[i] = stdatomic.load_u64(&c.histogram[i])
+		}
+		sigs << SignatureStats{
+			signature: sig
+			calls:     stdatomic.load_u64(&c.calls)
+			total_ns:  stdatomic.load_u64(&c.total_ns)
+			max_ns:    stdatomic.load_u64(&c.max_ns)
+			histogram: histogram
+		}
+	}
+	ss.mutex.runlock()
+	sigs.sort(a.calls > b.calls)
+
+	mc := method_cache_stats()
+	ts := thread_stats()
+	return Stats{
+		enabled:               $if jni_stats ? { true } $else { false }
+		signatures:            sigs
+		method_lookups:        mc.hits + mc.misses
+		method_cache_hits:     mc.hits
+		class_lookups:         stdatomic.load_u64(&ss.class_lookups)
+		classes_loaded:        stdatomic.load_u64(&ss.class_loads)
+		string_bytes:          stdatomic.load_u64(&ss.string_bytes)
+		array_bytes:           stdatomic.load_u64(&ss.array_bytes)
+		attaches:              ts.attaches - stdatomic.load_u64(&ss.attach_base)
+		detaches:              ts.detaches - stdatomic.load_u64(&ss.detach_base)
+		local_refs_high_water: C.gStatsLocalRefsHighWater()
+	}
+}
+
+// reset_stats starts a new recording period. The local reference high-water mark restarts
+// from the count of the calling thread.
+pub fn reset_stats() {
+	mut ss := stats_state()
+	ss.mutex.@lock()
+	ss.signatures.clear()
+	ss.mutex.unlock()
+	stdatomic.store_u64(&ss.class_lookups, 0)
+	stdatomic.store_u64(&ss.class_loads, 0)
+	stdatomic.store_u64(&ss.string_bytes, 0)
+	stdatomic.store_u64(&ss.array_bytes, 0)
+	ts := thread_stats()
+	stdatomic.store_u64(&ss.attach_base, ts.attaches)
+	stdatomic.store_u64(&ss.detach_base, ts.detaches)
+	mut mc := method_cache()
+	stdatomic.store_u64(&mc.hits, 0)
+	stdatomic.store_u64(&mc.misses, 0)
+	C.gStatsResetLocalRefs()
+}
+
+// str returns the statistics as a text report.
+pub fn (s Stats) str() string {
+	mut sb := strings.new_builder(256 + s.signatures.len * 128)
+	if !s.enabled {
+		sb.writeln('jni stats: not recorded, compile with `-d jni_stats`')
+	}
+	sb.writeln('method lookups: ${s.method_lookups} (${s.method_cache_hits} cache hits)')
+	sb.writeln('class lookups:  ${s.class_lookups} (${s.classes_loaded} loaded)')
+	sb.writeln('strings:        ${s.string_bytes} bytes')
+	sb.writeln('arrays:         ${s.array_bytes} bytes')
+	sb.writeln('threads:        ${s.attaches} attached, ${s.detaches} detached')
+	sb.writeln('local refs:     ${s.local_refs_high_water} high-water')
+	if s.signatures.len > 0 {
+		sb.writeln('${'calls':12} ${'mean':>10} ${'p50':>10} ${'p99':>10} ${'max':>10}  signature')
+		for sig in s.signatures {
+			sb.writeln('${sig.calls:12} ${sig.mean():>10} ${sig.percentile(0.5):>10} ${sig.percentile(0.99):>10} ${time.Duration(i64(sig.max_ns)):>10}  ${sig.signature}')
+		}
+	}
+	return sb.str()
+}
+
+// dump_stats writes the statistics report to stderr.
+pub fn dump_stats() {
+	eprint(stats().str())
+}
+
+// latency_bucket returns the histogram bucket for a call taking `ns` nanoseconds.
+@[inline]
+fn latency_bucket(ns u64) int {
+	b := bits.len_64(ns >> 6)
+	return if b < latency_buckets { b } else { latency_buckets - 1 }
+}
+
+// stats_now returns the start time of a call, when recording statistics.
+@[inline]
+fn stats_now() u64 {
+	$if jni_stats ? {
+		return time.sys_mono_now()
+	}
+	return 0
+}
+
+// stats_call records a call of `signature` that started at `start` (see `stats_now`).
+@[inline]
+fn stats_call(signature string, start u64) {
+	$if jni_stats ? {
+		record_call(signature, time.sys_mono_now() - start)
+	}
+}
+
+fn record_call(signature string, ns u64) {
+	mut ss := stats_state()
+	ss.mutex.@rlock()
+	mut c := ss.signatures[signature] or { unsafe { nil } }
+	ss.mutex.runlock()
+	if isnil(c) {
+		ss.mutex.@lock()
+		c = ss.signatures[signature] or {
+			n := &SignatureCounters{}
+			// The key must outlive the caller's (possibly temporary) string
+			ss.signatures[signature.clone()] = n
+			n
+		}
+		ss.mutex.unlock()
+	}
+	stdatomic.add_u64(&c.calls, 1)
+	stdatomic.add_u64(&c.total_ns, ns)
+	stdatomic.add_u64(&c.histogram[latency_bucket(ns)], 1)
+	C.gStatsMax(&c.max_ns, ns)
+}
+
+@[inline]
+fn stats_class_lookup(loaded bool) {
+	$if jni_stats ? {
+		mut ss := stats_state()
+		stdatomic.add_u64(&ss.class_lookups, 1)
+		if loaded {
+			stdatomic.add_u64(&ss.class_loads, 1)
+		}
+	}
+}
+
+@[inline]
+fn stats_string_bytes(n int) {
+	$if jni_stats ? {
+		mut ss := stats_state()
+		stdatomic.add_u64(&ss.string_bytes, u64(n))
+	}
+}
+
+@[inline]
+fn stats_array_bytes(n int) {
+	$if jni_stats ? {
+		mut ss := stats_state()
+		stdatomic.add_u64(&ss.array_bytes, u64(n))
+	}
+}
+
+// stats_local_ref counts `ref`, if not `nil`, as a new local reference.
+@[inline]
+fn stats_local_ref(ref voidptr) {
+	$if jni_stats ? {
+		if !isnil(ref) {
+			C.gStatsLocalRefs(1)
+		}
+	}
+}
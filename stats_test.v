@@ -0,0 +1,65 @@
+module jni
+
+import time
+
+fn test_latency_bucket_boundaries() {
+	assert latency_bucket(0) == 0
+	assert latency_bucket(63) == 0
+	assert latency_bucket(64) == 1
+	assert latency_bucket(127) == 1
+	assert latency_bucket(128) == 2
+	// Bucket `i` counts [2^(i+5), 2^(i+6)) ns
+	for i in 1 .. latency_buckets - 1 {
+		assert latency_bucket(u64(1) << (i + 5)) == i
+		assert latency_bucket((u64(1) << (i + 6)) - 1) == i
+	}
+	assert latency_bucket(u64(1) << (latency_buckets + 5)) == latency_buckets - 1
+	assert latency_bucket(max_u64) == latency_buckets - 1
+}
+
+fn test_percentile() {
+	mut histogram := [latency_buckets]u64{}
+	histogram[0] = 50 // < 64ns
+	histogram[2] = 49 // [128, 256) ns
+	histogram[5] = 1 // [1024, 2048) ns
+	s := SignatureStats{
+		calls:     100
+		total_ns:  20_000
+		max_ns:    1500
+		histogram: histogram
+	}
+	assert s.percentile(0.0) == time.Duration(64)
+	assert s.percentile(0.5) == time.Duration(256)
+	assert s.percentile(0.99) == time.Duration(2048)
+	assert s.percentile(1.0) == time.Duration(2048)
+	assert s.mean() == time.Duration(200)
+}
+
+fn test_percentile_last_bucket_is_max() {
+	mut histogram := [latency_buckets]u64{}
+	histogram[latency_buckets - 1] = 2
+	s := SignatureStats{
+		calls:     2
+		max_ns:    5_000_000_000
+		histogram: histogram
+	}
+	assert s.percentile(0.5) == time.Duration(5_000_000_000)
+}
+
+fn test_percentile_without_calls() {
+	s := SignatureStats{}
+	assert s.percentile(0.5) == 0
+	assert s.mean() == 0
+}
+
+fn test_record_call_keeps_the_maximum() {
+	signature := 'jni.stats_test.record_call() void'
+	for ns in [u64(100), 5000, 300] {
+		record_call(signature, ns)
+	}
+	st := stats().signatures.filter(it.signature == signature)
+	assert st.len == 1
+	assert st[0].calls == 3
+	assert st[0].max_ns == 5000
+	assert st[0].histogram[latency_bucket(5000)] == 1
+}
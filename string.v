@@ -0,0 +1,319 @@
+// Copyright(C) 2021 Lars Pontoppidan. All rights reserved.
+// Use of this source code is governed by an MIT license file distributed with this software package
+module jni
+
+import sync
+
+// Java -> V string decoding.
+//
+// Java strings are UTF-16. Instead of going through `GetStringUTFChars` (modified UTF-8,
+// allocated by the JavaVM) and copying that into a V string, the UTF-16 code units are
+// transcoded directly into a single V owned buffer.
+// Short strings are copied to the stack with `GetStringRegion`, longer strings are
+// read in place with `GetStringCritical`.
+
+// short_string_len is the maximum number of UTF-16 code units decoded via a stack buffer.
+const short_string_len = 64
+
+// get_string_region copies `len` UTF-16 code units of `str`, starting at `start`, to `buf`.
+@[inline]
+pub fn get_string_region(env &Env, str JavaString, start int, len int, buf &u16) {
+	C.GetStringRegion(env, str, jsize(start), jsize(len), &C.jchar(buf))
+}
+
+// get_string_utf_region copies `len` UTF-16 code units of `str`, starting at `start`,
+// converted to modified UTF-8, to `buf`.
+@[inline]
+pub fn get_string_utf_region(env &Env, str JavaString, start int, len int, buf &u8) {
+	C.GetStringUTFRegion(env, str, jsize(start), jsize(len), &char(buf))
+}
+
+// get_string_critical returns a pointer to the UTF-16 code units of `str`.
+// No JNI calls, or blocking calls, may be made before `release_string_critical` is called.
+@[inline]
+pub fn get_string_critical(env &Env, str JavaString) (&u16, bool) {
+	mut is_copy := jboolean(false)
+	chars := C.GetStringCritical(env, str, &is_copy)
+	$if debug {
+		// Nothing to release when `nil` is returned
+		if !isnil(chars) {
+			C.gCriticalEnter()
+		}
+	}
+	return &u16(chars), j2v_boolean(is_copy)
+}
+
+// release_string_critical releases the code units obtained via `get_string_critical`.
+@[inline]
+pub fn release_string_critical(env &Env, str JavaString, chars &u16) {
+	C.ReleaseStringCritical(env, str, &C.jchar(chars))
+	$if debug {
+		C.gCriticalExit()
+	}
+}
+
+// decode_string returns a new V string with the contents of the Java string `jstr`.
+pub fn decode_string(env &Env, jstr JavaString) string {
+	if isnil(jstr) {
+		return ''
+	}
+	len := get_string_length(env, jstr)
+	stats_string_bytes(len * 2)
+	if len == 0 {
+		return ''
+	}
+	if len <= short_string_len {
+		mut units := [short_string_len]u16{}
+		mut bytes := [short_string_len * 3]u8{}
+		get_string_region(env, jstr, 0, len, &units[0])
+		n := unsafe { utf16_to_utf8(&units[0], len, &bytes[0]) }
+		return unsafe { tos(&bytes[0], n).clone() }
+	}
+	// The modified UTF-8 length is an upper bound of the (standard) UTF-8 length
+	max_len := get_string_utf_length(env, jstr)
+	mut buf := unsafe { malloc_noscan(max_len + 1) }
+	chars, _ := get_string_critical(env, jstr)
+	n := unsafe { utf16_to_utf8(chars, len, buf) }
+	release_string_critical(env, jstr, chars)
+	unsafe {
+		buf[n] = 0
+	}
+	return unsafe { buf.vstring_with_len(n) }
+}
+
+// decode_string_into decodes the Java string `jstr` into `buf`, growing it if needed,
+// and returns a string *view* of `buf`. The returned string is only valid until `buf`
+// is modified, `.clone()` it to keep it around. Reusing `buf` avoids allocating per string.
+pub fn decode_string_into(env &Env, jstr JavaString, mut buf []u8) string {
+	if isnil(jstr) {
+		return ''
+	}
+	len := get_string_length(env, jstr)
+	stats_string_bytes(len * 2)
+	if len == 0 {
+		return ''
+	}
+	if buf.len < len * 3 {
+		buf = []u8{len: len * 3}
+	}
+	mut n := 0
+	if len <= short_string_len {
+		mut units := [short_string_len]u16{}
+		get_string_region(env, jstr, 0, len, &units[0])
+		n = unsafe { utf16_to_utf8(&units[0], len, &buf[0]) }
+	} else {
+		chars, _ := get_string_critical(env, jstr)
+		n = unsafe { utf16_to_utf8(chars, len, &buf[0]) }
+		release_string_critical(env, jstr, chars)
+	}
+	return unsafe { tos(&buf[0], n) }
+}
+
+// utf16_to_utf8 transcodes `len` UTF-16 code units from `src` to UTF-8 in `dst`
+// and returns the number of bytes written. `dst` must have room for `len * 3` bytes.
+// Surrogate pairs are combined into one code point, unpaired surrogates are replaced
+// by U+FFFD and U+0000 is encoded as a single zero byte (not modified UTF-8's `C0 80`).
+@[direct_array_access; unsafe]
+fn utf16_to_utf8(src &u16, len int, dst &u8) int {
+	mut i := 0
+	mut n := 0
+	for i < len {
+		// ASCII fast path, 4 code units per iteration
+		for i + 4 <= len {
+			mut w := u64(0)
+			C.memcpy(&w, &src[i], 8)
+			if w & u64(0xFF80FF80FF80FF80) != 0 {
+				break
+			}
+			dst[n] = u8(src[i])
+			dst[n + 1] = u8(src[i + 1])
+			dst[n + 2] = u8(src[i + 2])
+			dst[n + 3] = u8(src[i + 3])
+			i += 4
+			n += 4
+		}
+		if i >= len {
+			break
+		}
+		c := u32(src[i])
+		i++
+		if c < 0x80 {
+			dst[n] = u8(c)
+			n++
+		} else if c < 0x800 {
+			dst[n] = u8(0xC0 | (c >> 6))
+			dst[n + 1] = u8(0x80 | (c & 0x3F))
+			n += 2
+		} else if c >= 0xD800 && c <= 0xDFFF {
+			if c <= 0xDBFF && i < len && src[i] >= 0xDC00 && src[i] <= 0xDFFF {
+				cp := 0x10000 + ((c - 0xD800) << 10) + (u32(src[i]) - 0xDC00)
+				i++
+				dst[n] = u8(0xF0 | (cp >> 18))
+				dst[n + 1] = u8(0x80 | ((cp >> 12) & 0x3F))
+				dst[n + 2] = u8(0x80 | ((cp >> 6) & 0x3F))
+				dst[n + 3] = u8(0x80 | (cp & 0x3F))
+				n += 4
+			} else {
+				// Unpaired surrogate
+				dst[n] = 0xEF
+				dst[n + 1] = 0xBF
+				dst[n + 2] = 0xBD
+				n += 3
+			}
+		} else {
+			dst[n] = u8(0xE0 | (c >> 12))
+			dst[n + 1] = u8(0x80 | ((c >> 6) & 0x3F))
+			dst[n + 2] = u8(0x80 | (c & 0x3F))
+			n += 3
+		}
+	}
+	return n
+}
+
+// V -> Java string encoding.
+//
+// V strings are UTF-8 while `NewStringUTF` expects *modified* UTF-8 (which the JavaVM has to
+// validate and rescan, and which can't contain zero bytes). Encoding to UTF-16 in V and
+// using `NewString` avoids that. Short strings are encoded via a stack buffer.
+
+// short_encode_len is the maximum byte length of strings encoded via a stack buffer.
+const short_encode_len = 256
+
+// encode_string returns a new Java string (a local reference) with the contents of `s`.
+pub fn encode_string(env &Env, s string) JavaString {
+	$if jni_stats ? {
+		C.gStatsLocalRefs(1)
+		stats_string_bytes(s.len)
+	}
+	if s.len <= short_encode_len {
+		mut units := [short_encode_len]u16{}
+		n := unsafe { utf8_to_utf16(s.str, s.len, &units[0]) }
+		return C.NewString(env, &C.jchar(&units[0]), jsize(n))
+	}
+	mut units := unsafe { &u16(malloc_noscan(s.len * int(sizeof(u16)))) }
+	n := unsafe { utf8_to_utf16(s.str, s.len, units) }
+	jstr := C.NewString(env, &C.jchar(units), jsize(n))
+	unsafe { free(units) }
+	return jstr
+}
+
+// utf8_to_utf16 transcodes `len` bytes of UTF-8 from `src` to UTF-16 in `dst` and returns
+// the number of code units written. `dst` must have room for `len` code units.
+// Invalid or truncated sequences are replaced by U+FFFD, one per offending byte.
+@[direct_array_access; unsafe]
+fn utf8_to_utf16(src &u8, len int, dst &u16) int {
+	mut i := 0
+	mut n := 0
+	for i < len {
+		// ASCII fast path, 8 bytes per iteration
+		for i + 8 <= len {
+			mut w := u64(0)
+			C.memcpy(&w, &src[i], 8)
+			if w & u64(0x8080808080808080) != 0 {
+				break
+			}
+			for k in 0 .. 8 {
+				dst[n + k] = u16(src[i + k])
+			}
+			i += 8
+			n += 8
+		}
+		if i >= len {
+			break
+		}
+		b0 := u32(src[i])
+		if b0 < 0x80 {
+			dst[n] = u16(b0)
+			i++
+			n++
+			continue
+		}
+		mut cp := u32(0xFFFD)
+		mut size := 1
+		if b0 >= 0xC2 && b0 <= 0xDF && i + 1 < len && src[i + 1] & 0xC0 == 0x80 {
+			cp = ((b0 & 0x1F) << 6) | (u32(src[i + 1]) & 0x3F)
+			size = 2
+		} else if b0 >= 0xE0 && b0 <= 0xEF && i + 2 < len && src[i + 1] & 0xC0 == 0x80
+			&& src[i + 2] & 0xC0 == 0x80 {
+			c := ((b0 & 0x0F) << 12) | ((u32(src[i + 1]) & 0x3F) << 6) | (u32(src[i + 2]) & 0x3F)
+			// Reject overlong encodings and encoded surrogates
+			if c >= 0x800 && (c < 0xD800 || c > 0xDFFF) {
+				cp = c
+				size = 3
+			}
+		} else if b0 >= 0xF0 && b0 <= 0xF4 && i + 3 < len && src[i + 1] & 0xC0 == 0x80
+			&& src[i + 2] & 0xC0 == 0x80 && src[i + 3] & 0xC0 == 0x80 {
+			c := ((b0 & 0x07) << 18) | ((u32(src[i + 1]) & 0x3F) << 12) | ((u32(src[i + 2]) & 0x3F) << 6) | (u32(src[i + 3]) & 0x3F)
+			if c >= 0x10000 && c <= 0x10FFFF {
+				cp = c
+				size = 4
+			}
+		}
+		i += size
+		if cp >= 0x10000 {
+			c := cp - 0x10000
+			dst[n] = u16(0xD800 + (c >> 10))
+			dst[n + 1] = u16(0xDC00 + (c & 0x3FF))
+			n += 2
+		} else {
+			dst[n] = u16(cp)
+			n++
+		}
+	}
+	return n
+}
+
+// StringInterns holds global references to Java strings created via `intern`.
+struct StringInterns {
+mut:
+	mutex   &sync.RwMutex = sync.new_rwmutex()
+	strings map[string]JavaString
+}
+
+fn string_interns() &StringInterns {
+	mut si := unsafe { &StringInterns(state(.string_interns)) }
+	if isnil(si) {
+		si = unsafe { &StringInterns(set_state_once(.string_interns, &StringInterns{})) }
+	}
+	return si
+}
+
+// intern returns a Java string with the contents of `s` that is created once per process.
+// The returned string is a *global* reference owned by the intern cache; it must not be deleted
+// by the caller. Use it for strings passed to Java over and over again, like constant keys,
+// method or service names.
+pub fn intern(env &Env, s string) JavaString {
+	mut si := string_interns()
+	si.mutex.@rlock()
+	if jstr := si.strings[s] {
+		si.mutex.runlock()
+		return jstr
+	}
+	si.mutex.runlock()
+
+	local := encode_string(env, s)
+	jstr := JavaString(new_global_ref(env, JavaObject(local)))
+	delete_local_ref(env, JavaObject(local))
+
+	si.mutex.@lock()
+	defer {
+		si.mutex.unlock()
+	}
+	if existing := si.strings[s] {
+		delete_global_ref(env, JavaObject(jstr))
+		return existing
+	}
+	si.strings[s] = jstr
+	return jstr
+}
+
+// clear_interned_strings deletes all strings created via `intern`.
+pub fn clear_interned_strings(env &Env) {
+	mut si := string_interns()
+	si.mutex.@lock()
+	for _, jstr in si.strings {
+		delete_global_ref(env, JavaObject(jstr))
+	}
+	si.strings.clear()
+	si.mutex.unlock()
+}
@@ -0,0 +1,100 @@
+module jni
+
+// utf8_of decodes `units` with `utf16_to_utf8`.
+fn utf8_of(units []u16) string {
+	if units.len == 0 {
+		return ''
+	}
+	mut buf := []u8{len: units.len * 3}
+	n := unsafe { utf16_to_utf8(&units[0], units.len, &buf[0]) }
+	return buf[..n].bytestr()
+}
+
+// ascii_units returns the UTF-16 code units of the ASCII string `s`.
+fn ascii_units(s string) []u16 {
+	return s.bytes().map(u16(it))
+}
+
+fn test_utf16_to_utf8_ascii() {
+	assert utf8_of([]u16{}) == ''
+	assert utf8_of(ascii_units('V')) == 'V'
+	// Long enough for the 4 units per iteration fast path, with a tail
+	assert utf8_of(ascii_units('Hello, JNI world! 0123456789')) == 'Hello, JNI world! 0123456789'
+}
+
+fn test_utf16_to_utf8_bmp() {
+	assert utf8_of([u16(0xE6), 0xF8, 0xE5]) == 'æøå'
+	assert utf8_of([u16(0x20AC)]) == '€'
+	// A non ASCII unit inside a 4 unit word leaves the fast path, which resumes after it
+	mut units := ascii_units('abc')
+	units << 0x20AC
+	units << ascii_units('defgh')
+	assert utf8_of(units) == 'abc€defgh'
+}
+
+fn test_utf16_to_utf8_surrogate_pairs() {
+	assert utf8_of([u16(0xD83D), 0xDE00]) == '😀'
+	assert utf8_of([u16(0xDBFF), 0xDFFF]) == [u8(0xF4), 0x8F, 0xBF, 0xBF].bytestr()
+	assert utf8_of([u16(0x78), 0xD83D, 0xDE00, 0x79]) == 'x😀y'
+}
+
+fn test_utf16_to_utf8_unpaired_surrogates() {
+	assert utf8_of([u16(0x61), 0xD800, 0x62]) == 'a�b'
+	assert utf8_of([u16(0xDC00)]) == '�'
+	// A high surrogate at the end, and a low surrogate before a high one
+	assert utf8_of([u16(0x61), 0xD83D]) == 'a�'
+	assert utf8_of([u16(0xDE00), 0xD83D]) == '��'
+}
+
+fn test_utf16_to_utf8_nul() {
+	// U+0000 is a single zero byte, not modified UTF-8's `C0 80`
+	assert utf8_of([u16(0x41), 0, 0x42]).bytes() == [u8(0x41), 0, 0x42]
+}
+
+// utf16_of encodes the UTF-8 bytes `b` with `utf8_to_utf16`.
+fn utf16_of(b []u8) []u16 {
+	if b.len == 0 {
+		return []u16{}
+	}
+	mut units := []u16{len: b.len}
+	n := unsafe { utf8_to_utf16(&b[0], b.len, &units[0]) }
+	return units[..n].clone()
+}
+
+fn test_utf8_to_utf16_ascii() {
+	assert utf16_of([]u8{}) == []u16{}
+	// Long enough for the 8 bytes per iteration fast path, with a tail
+	s := 'Hello, JNI world! 0123456789'
+	assert utf16_of(s.bytes()) == ascii_units(s)
+}
+
+fn test_utf8_to_utf16_bmp_and_surrogate_pairs() {
+	assert utf16_of('æøå€'.bytes()) == [u16(0xE6), 0xF8, 0xE5, 0x20AC]
+	assert utf16_of('😀'.bytes()) == [u16(0xD83D), 0xDE00]
+	assert utf16_of([u8(0xF4), 0x8F, 0xBF, 0xBF]) == [u16(0xDBFF), 0xDFFF]
+}
+
+fn test_utf8_to_utf16_invalid() {
+	replacement := u16(0xFFFD)
+	assert utf16_of([u8(0xFF)]) == [replacement]
+	// A truncated sequence, one replacement per byte
+	assert utf16_of([u8(0xE2), 0x82]) == [replacement, replacement]
+	assert utf16_of([u8(0x61), 0xF0, 0x9F, 0x98]) == [u16(0x61), replacement, replacement, replacement]
+	// Overlong encodings, encoded surrogates and code points above U+10FFFF
+	assert utf16_of([u8(0xC0), 0xAF]) == [replacement, replacement]
+	assert utf16_of([u8(0xE0), 0x80, 0xAF]) == [replacement, replacement, replacement]
+	assert utf16_of([u8(0xED), 0xA0, 0x80]) == [replacement, replacement, replacement]
+	assert utf16_of([u8(0xF4), 0x90, 0x80, 0x80]) == [replacement, replacement, replacement, replacement]
+	// A continuation byte on its own
+	assert utf16_of([u8(0x80), 0x62]) == [replacement, u16(0x62)]
+}
+
+fn test_utf8_to_utf16_nul() {
+	assert utf16_of([u8(0x41), 0, 0x42]) == [u16(0x41), 0, 0x42]
+}
+
+fn test_utf8_utf16_round_trip() {
+	for s in ['', 'V', 'abcdefgh😀ijklmnop€qr æøå', '日本語のテキスト', '🇩🇰 flag, 𝄞 clef'] {
+		assert utf8_of(utf16_of(s.bytes())) == s
+	}
+}
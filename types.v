@@ -1,7 +1,26 @@
 module jni
 
-type Void = bool
-type Type = JavaObject | Void | bool | f32 | f64 | i16 | i64 | int | rune | string | u8
+// Void is the V type of the result of `void` Java methods, e.g. `jni.call0[jni.Void](env, obj, 'run')`.
+pub type Void = bool
+type Type = JavaObject | TypedObject | Void | bool | f32 | f64 | i16 | i64 | int | rune | string | u8
+
+// TypedObject is a Java object that carries its type descriptor, e.g. `Lio/vlang/V;`.
+// Passing a `TypedObject` as argument avoids looking up the class of the object.
+pub struct TypedObject {
+pub:
+	obj        JavaObject
+	descriptor string
+}
+
+// typed_object returns `obj` as a `TypedObject` of the class `class_name` (e.g. 'io.vlang.V'),
+// or of the array type `class_name` (e.g. '[I' or '[Ljava.lang.String;').
+pub fn typed_object(obj JavaObject, class_name string) TypedObject {
+	name := class_name.replace('.', '/')
+	return TypedObject{
+		obj:        obj
+		descriptor: if name.starts_with('[') { name } else { 'L' + name + ';' }
+	}
+}
 
 // pub type Any = string | int | i64 | f32 | f64 | bool | []Any | map[voidptr]Any
 pub enum MethodType {
@@ -9,6 +28,46 @@ pub enum MethodType {
 	object
 }
 
+// ValueKind is the V type of an argument or return value in a `jni` style signature.
+pub enum ValueKind {
+	void
+	bool
+	u8
+	rune
+	i16
+	int
+	i64
+	f32
+	f64
+	string
+	object
+}
+
+// value_kind returns the `ValueKind` of a V type name used in a `jni` style signature.
+// Fully qualified class names (e.g. 'io.vlang.V'), array descriptors (e.g. '[I') and 'object' are objects.
+// It panics on other names, which the Java descriptor would silently turn into `void`.
+pub fn value_kind(v_type string) ValueKind {
+	return match v_type {
+		'', 'void' { .void }
+		'bool' { .bool }
+		'u8' { .u8 }
+		'rune' { .rune }
+		'i16' { .i16 }
+		'int' { .int }
+		'i64' { .i64 }
+		'f32' { .f32 }
+		'f64' { .f64 }
+		'string' { .string }
+		'object' { .object }
+		else {
+			if !v_type.starts_with('[') && !v_type.contains('.') && !v_type.contains('/') {
+				panic(@MOD + '.' + @FN + ': unknown type "${v_type}", use a V primitive type, string, object or a fully qualified class name')
+			}
+			.object
+		}
+	}
+}
+
 /*
 Signature table
 
@@ -86,8 +145,10 @@ fn v2j_signature_type(env &Env, vt Type) string {
 			'Ljava/lang/String;'
 		}
 		JavaObject {
-			//'Ljava/lang/Object;'
-			'L' + vt.class_name(env).replace('.', '/') + ';'
+			object_descriptor(env, vt)
+		}
+		TypedObject {
+			vt.descriptor
 		}
 		else {
 			'V'
@@ -97,6 +158,10 @@ fn v2j_signature_type(env &Env, vt Type) string {
 
 fn v2j_string_signature_type(vt string) string {
 	type_or_void := fn (s string) string {
+		if s.starts_with('[') {
+			// An array descriptor, e.g. '[I' or '[Ljava.lang.String;'
+			return s.replace('.', '/')
+		}
 		if s.contains('.') || s.contains('/') {
 			return 'L' + s.replace('.', '/') + ';'
 		}
@@ -130,6 +195,9 @@ fn v2j_string_signature_type(vt string) string {
 		'string' {
 			'Ljava/lang/String;'
 		}
+		'object' {
+			'Ljava/lang/Object;'
+		}
 		else {
 			type_or_void(vt)
 		}
@@ -155,12 +223,12 @@ pub fn v2j_value(env &Env, vt Type) JavaValue {
 		}
 		f32 {
 			JavaValue{
-				i: jfloat(vt)
+				f: jfloat(vt)
 			}
 		}
 		f64 {
 			JavaValue{
-				i: jdouble(vt)
+				d: jdouble(vt)
 			}
 		}
 		i16 {
@@ -194,6 +262,11 @@ pub fn v2j_value(env &Env, vt Type) JavaValue {
 				l: vt // JavaObject(vt)
 			}
 		}
+		TypedObject {
+			JavaValue{
+				l: vt.obj
+			}
+		}
 		else {
 			JavaValue{}
 		}
@@ -209,15 +282,11 @@ pub fn v2j_signature(fqn_signature string) (string, string, string) {
 	return clazz, f_name, f_sig
 }
 
+// j2v_string returns a V string with the contents of the Java string `jstr`.
+// See `decode_string_into` for decoding into a reusable buffer.
 @[inline]
 pub fn j2v_string(env &Env, jstr JavaString) string {
-	mut cn := ''
-	unsafe {
-		char_ptr, _ := get_string_utf_chars(env, jstr)
-		cn = '' + char_ptr.vstring()
-		release_string_utf_chars(env, jstr, char_ptr)
-	}
-	return cn
+	return decode_string(env, jstr)
 }
 
 @[inline]
@@ -313,7 +382,8 @@ pub fn jchar(val rune) C.jchar {
 	return u16(val) // C.jchar(val)
 }
 
+// jstring returns a new Java string (a local reference) with the contents of `val`.
 @[inline]
 pub fn jstring(env &Env, val string) C.jstring {
-	return new_string_utf(env, val)
+	return encode_string(env, val)
 }
@@ -6,6 +6,9 @@ pub fn default_vm() &JavaVM {
 	return C.gGetJavaVM()
 }
 
+// default_env returns the `Env` of the calling thread.
+// The `Env` is cached per thread; a native thread is attached to the JavaVM
+// (as a daemon) on first use and detached automatically when it exits.
 pub fn default_env() &Env {
 	return C.gGetEnv()
 }
@@ -14,6 +17,104 @@ pub fn set_java_vm(vm &JavaVM) {
 	C.gSetJavaVM(vm)
 }
 
+// on_unload releases all global references and cached IDs held by the module.
+// It should be called from the library's exported `JNI_OnUnload`. Nothing is released
+// if the calling thread is not attached to `vm`; it is never attached by `on_unload`.
+pub fn on_unload(vm &JavaVM) {
+	if isnil(vm) {
+		return
+	}
+	env := C.gEnvOf(vm)
+	if isnil(env) {
+		return
+	}
+	clear_method_cache(env)
+	clear_class_descriptor_cache(env)
+	clear_class_bindings(env)
+	clear_interned_strings(env)
+	free_direct_buffers(env)
+	clear_field_maps(env)
+	clear_exception_state(env)
+	clear_class_registry(env)
+	$if debug {
+		report_leaked_refs()
+	}
+}
+
+// StateSlot enumerates the process-wide state kept in `gStateSlots` (see c/helpers.h).
+enum StateSlot {
+	method_cache
+	class_descriptors
+	class_bindings
+	string_interns
+	direct_buffers
+	field_maps
+	exceptions
+	stats
+	refs
+}
+
+// state returns the state stored in `slot` or `nil` if nothing is stored yet.
+@[inline]
+fn state(slot StateSlot) voidptr {
+	return C.gGetState(int(slot))
+}
+
+// set_state_once stores `ptr` in `slot` unless another thread came first.
+// The state that ends up in the slot is returned.
+@[inline]
+fn set_state_once(slot StateSlot, ptr voidptr) voidptr {
+	return C.gSetStateOnce(int(slot), ptr)
+}
+
+// load_once returns the pointer published in `dst` by `publish_once`, or `nil`.
+@[inline]
+fn load_once(dst &voidptr) voidptr {
+	return C.gLoadOnce(dst)
+}
+
+// publish_once stores `ptr` in `dst` unless another thread came first.
+// The pointer that ends up in `dst` is returned.
+@[inline]
+fn publish_once(dst &voidptr, ptr voidptr) voidptr {
+	return C.gPublishOnce(dst, ptr)
+}
+
+// attach_current_thread returns the `Env` of the calling thread, attaching it to the JavaVM
+// as a daemon thread named `name` (shown in Java thread dumps) if it isn't attached yet.
+// The thread is detached automatically when it exits.
+pub fn attach_current_thread(name string) &Env {
+	// `name` may be a slice, which is not NUL terminated
+	env := C.gAttachThread(&char(name.clone().str))
+	if isnil(env) {
+		panic(@MOD + '.' + @FN + ': could not attach thread "${name}" to the JavaVM (${ptr_str(default_vm())})')
+	}
+	return env
+}
+
+// detach_current_thread detaches the calling thread now, if it was attached by `jni`.
+pub fn detach_current_thread() {
+	C.gDetachThread()
+}
+
+// ThreadStats counts the threads attached to and detached from the JavaVM by `jni`.
+pub struct ThreadStats {
+pub:
+	attaches u64
+	detaches u64
+}
+
+// thread_stats returns the number of thread attaches and detaches made so far.
+pub fn thread_stats() ThreadStats {
+	return ThreadStats{
+		attaches: C.gAttachCountGet()
+		detaches: C.gDetachCountGet()
+	}
+}
+
+// env_detach returns the `Env` of the calling thread.
+// Deprecated: threads are attached once and detached at thread exit, so the returned
+// `need_detach` is always `false`. Use `default_env` instead.
 pub fn env_detach() (&Env, bool) {
 	env := &C.JNIEnv(unsafe { nil })
 	need_detach := C.gEnvNeedDetach(&env)
@@ -25,6 +126,7 @@ pub fn env_detach() (&Env, bool) {
 	return env, need_detach
 }
 
+// detach_thread detaches the calling thread if `need_detach` is `true`.
 pub fn detach_thread(need_detach bool) {
 	if need_detach {
 		C.gDetachThread()